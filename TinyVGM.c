@@ -47,9 +47,10 @@
 #define TinyVGM_DEBUG	1
 #endif
 
-#if TinyVGM_DEBUG != 1
-#define printf
-#define fprintf
+#if TinyVGM_DEBUG == 1
+#define tinyvgm_trace(ctx, event, a, b)	do { if ((ctx)->callback.trace) (ctx)->callback.trace((ctx)->userp, (event), (a), (b)); } while (0)
+#else
+#define tinyvgm_trace(ctx, event, a, b)	do { } while (0)
 #endif
 
 // -1: Unused, -2: Data block
@@ -101,10 +102,240 @@ static int32_t tinyvgm_io_readall(TinyVGMContext *ctx, uint8_t *buf, uint32_t le
 	}
 }
 
+#if TinyVGM_BUFFER_SIZE
+
+#define TinyVGM_BUFFER_HALF	(TinyVGM_BUFFER_SIZE / 2)
+
+static void tinyvgm_buffer_drain(TinyVGMContext *ctx) {
+	if (ctx->buffer.pending) {
+		ctx->buffer.pending = 0;
+		ctx->callback.read_wait(ctx->userp);
+	}
+}
+
+static void tinyvgm_buffer_fill_start(TinyVGMContext *ctx, unsigned int half) {
+	ctx->buffer.pending = 0;
+	ctx->buffer.ready = 0;
+
+	if (ctx->callback.read_start && !ctx->buffer.eof) {
+		if (ctx->callback.read_start(ctx->userp, ctx->buffer.data[half], TinyVGM_BUFFER_HALF) == 0) {
+			ctx->buffer.pending = 1;
+		}
+	}
+}
+
+static int tinyvgm_buffer_fill_finish(TinyVGMContext *ctx, unsigned int half) {
+	int32_t rc;
+
+	// Already completed by tinyvgm_buffer_settle()
+	if (ctx->buffer.ready) {
+		ctx->buffer.ready = 0;
+		return TinyVGM_OK;
+	}
+
+	if (ctx->buffer.pending) {
+		ctx->buffer.pending = 0;
+		rc = ctx->callback.read_wait(ctx->userp);
+	} else if (ctx->buffer.eof) {
+		rc = 0;
+	} else {
+		rc = tinyvgm_io_readall(ctx, ctx->buffer.data[half], TinyVGM_BUFFER_HALF);
+	}
+
+	if (rc < 0) {
+		return TinyVGM_EIO;
+	}
+
+	ctx->buffer.len[half] = (uint32_t)rc;
+
+	if (rc < TinyVGM_BUFFER_HALF) {
+		ctx->buffer.eof = 1;
+	}
+
+	tinyvgm_trace(ctx, TinyVGM_TraceEvent_BufferRefill, half, (uint32_t)rc);
+
+	return TinyVGM_OK;
+}
+
+// Completes the transfer in flight, if any, keeping its data for tinyvgm_buffer_next()
+static int tinyvgm_buffer_settle(TinyVGMContext *ctx) {
+	if (!ctx->buffer.pending) {
+		return TinyVGM_OK;
+	}
+
+	int rc = tinyvgm_buffer_fill_finish(ctx, ctx->buffer.cur ^ 1);
+
+	if (rc != TinyVGM_OK) {
+		return rc;
+	}
+
+	ctx->buffer.ready = 1;
+
+	return TinyVGM_OK;
+}
+
+static int tinyvgm_buffer_next(TinyVGMContext *ctx) {
+	unsigned int next = ctx->buffer.cur ^ 1;
+
+	int rc = tinyvgm_buffer_fill_finish(ctx, next);
+
+	if (rc != TinyVGM_OK) {
+		return rc;
+	}
+
+	ctx->buffer.cur = next;
+	ctx->buffer.pos = 0;
+
+	// The drained half is free now, refill it while this one is being decoded
+	tinyvgm_buffer_fill_start(ctx, next ^ 1);
+
+	return TinyVGM_OK;
+}
+
+#endif
+
 static inline int tinyvgm_io_seek(TinyVGMContext *ctx, uint32_t pos) {
+#if TinyVGM_BUFFER_SIZE
+	// Never move the file position under an in-flight transfer
+	tinyvgm_buffer_drain(ctx);
+#endif
+
 	return ctx->callback.seek(ctx->userp, pos);
 }
 
+/*
+    Command stream I/O. Without TinyVGM_BUFFER_SIZE these map straight to the read/seek
+    callbacks, otherwise they are served from the double buffer.
+*/
+
+static int tinyvgm_stream_begin(TinyVGMContext *ctx, uint32_t pos) {
+	if (tinyvgm_io_seek(ctx, pos) != 0) {
+		return TinyVGM_EIO;
+	}
+
+#if TinyVGM_BUFFER_SIZE
+	ctx->buffer.eof = 0;
+	ctx->buffer.ready = 0;
+	ctx->buffer.cur = 0;
+	ctx->buffer.pos = 0;
+
+	tinyvgm_buffer_fill_start(ctx, 0);
+
+	int rc = tinyvgm_buffer_fill_finish(ctx, 0);
+
+	if (rc != TinyVGM_OK) {
+		return rc;
+	}
+
+	tinyvgm_buffer_fill_start(ctx, 1);
+#endif
+
+	return TinyVGM_OK;
+}
+
+static int tinyvgm_stream_read(TinyVGMContext *ctx, uint8_t *buf, uint32_t len) {
+#if TinyVGM_BUFFER_SIZE
+	while (len) {
+		uint32_t avail = ctx->buffer.len[ctx->buffer.cur] - ctx->buffer.pos;
+
+		if (!avail) {
+			if (ctx->buffer.len[ctx->buffer.cur] < TinyVGM_BUFFER_HALF) {
+				return TinyVGM_EIO;
+			}
+
+			int rc = tinyvgm_buffer_next(ctx);
+
+			if (rc != TinyVGM_OK) {
+				return rc;
+			}
+
+			continue;
+		}
+
+		if (avail > len) {
+			avail = len;
+		}
+
+		memcpy(buf, ctx->buffer.data[ctx->buffer.cur] + ctx->buffer.pos, avail);
+		ctx->buffer.pos += avail;
+		buf += avail;
+		len -= avail;
+	}
+
+	return TinyVGM_OK;
+#else
+	if (tinyvgm_io_read(ctx, buf, len) != (int32_t)len) {
+		return TinyVGM_EIO;
+	}
+
+	return TinyVGM_OK;
+#endif
+}
+
+static inline int tinyvgm_stream_read_byte(TinyVGMContext *ctx, uint8_t *val) {
+#if TinyVGM_BUFFER_SIZE
+	if (ctx->buffer.pos < ctx->buffer.len[ctx->buffer.cur]) {
+		*val = ctx->buffer.data[ctx->buffer.cur][ctx->buffer.pos++];
+		return TinyVGM_OK;
+	}
+#endif
+
+	return tinyvgm_stream_read(ctx, val, 1);
+}
+
+// Returns a pointer to the next `len' bytes. `buf' is only used when they aren't contiguous in memory.
+static inline const uint8_t *tinyvgm_stream_params(TinyVGMContext *ctx, uint8_t *buf, uint32_t len) {
+#if TinyVGM_BUFFER_SIZE
+	if (ctx->buffer.pos + len <= ctx->buffer.len[ctx->buffer.cur]) {
+		const uint8_t *ret = ctx->buffer.data[ctx->buffer.cur] + ctx->buffer.pos;
+		ctx->buffer.pos += len;
+		return ret;
+	}
+#endif
+
+	if (tinyvgm_stream_read(ctx, buf, len) != TinyVGM_OK) {
+		return NULL;
+	}
+
+	return buf;
+}
+
+// Skips `len' bytes. `pos' is the absolute file offset after skipping.
+static int tinyvgm_stream_skip(TinyVGMContext *ctx, uint32_t len, uint32_t pos) {
+#if TinyVGM_BUFFER_SIZE
+	uint32_t avail = ctx->buffer.len[ctx->buffer.cur] - ctx->buffer.pos;
+
+	if (len <= avail) {
+		ctx->buffer.pos += len;
+		return TinyVGM_OK;
+	}
+
+	uint32_t rest = len - avail;
+
+	// Ends within the next half, no need to seek
+	if (ctx->buffer.len[ctx->buffer.cur] == TinyVGM_BUFFER_HALF && rest <= TinyVGM_BUFFER_HALF) {
+		int rc = tinyvgm_buffer_next(ctx);
+
+		if (rc != TinyVGM_OK) {
+			return rc;
+		}
+
+		if (rest > ctx->buffer.len[ctx->buffer.cur]) {
+			return TinyVGM_EIO;
+		}
+
+		ctx->buffer.pos = rest;
+		return TinyVGM_OK;
+	}
+#else
+	(void)len;
+#endif
+
+	tinyvgm_trace(ctx, TinyVGM_TraceEvent_DataBlockSkip, pos, len);
+
+	return tinyvgm_stream_begin(ctx, pos);
+}
+
 int tinyvgm_parse_header(TinyVGMContext *ctx) {
 	if (tinyvgm_io_seek(ctx, 0) != 0) {
 		return TinyVGM_EIO;
@@ -122,14 +353,12 @@ int tinyvgm_parse_header(TinyVGMContext *ctx) {
 		}
 		val=(uint_fast32_t)buf[0] | ((uint_fast32_t)buf[1] << 8) | ((uint_fast32_t)buf[2] << 16) | ((uint_fast32_t)buf[3] << 24);
 
-		fprintf(stderr, "tinyvgm_parse_header: offset: 0x%04x, value: 0x%08" PRIx32 " (%" PRId32 ")\n", (unsigned int)(i * sizeof(uint32_t)), val, val);
+		tinyvgm_trace(ctx, TinyVGM_TraceEvent_HeaderField, (uint32_t)(i * sizeof(uint32_t)), val);
 
 		if (i == TinyVGM_HeaderField_Identity) {
 			if (val != 0x206d6756) {
 				return TinyVGM_EINVAL;
 			}
-
-			fprintf(stderr, "tinyvgm_parse_header: valid VGM ident\n");
 		} else if (i == TinyVGM_HeaderField_Version) {
 			if (val < 0x00000151) {
 				loop_end = TinyVGM_HeaderField_SegaPCM_Clock;
@@ -183,23 +412,16 @@ int tinyvgm_parse_metadata(TinyVGMContext *ctx, uint32_t offset_abs) {
 		}
 		val=(uint_fast32_t)buf[0] | ((uint_fast32_t)buf[1] << 8) | ((uint_fast32_t)buf[2] << 16) | ((uint_fast32_t)buf[3] << 24);
 
-		fprintf(stderr, "tinyvgm_parse_metadata: offset: 0x%04x, value: 0x%08" PRIx32 " (%" PRId32 ")\n", (unsigned int)(i * sizeof(uint32_t)), val, val);
+		tinyvgm_trace(ctx, TinyVGM_TraceEvent_MetadataField, (uint32_t)(i * sizeof(uint32_t)), val);
 
 		switch (i) {
 			case 0:
 				if (val != 0x20336447) {
 					return TinyVGM_EINVAL;
 				}
-
-				fprintf(stderr, "tinyvgm_parse_metadata: valid GD3 ident\n");
-				break;
-
-			case 1:
-				fprintf(stderr, "tinyvgm_parse_metadata: GD3 version: 0x%08" PRIx32 "\n", val);
 				break;
 
 			case 2:
-				fprintf(stderr, "tinyvgm_parse_metadata: data len: %" PRIu32 "\n", val);
 				metadata_len = val;
 				break;
 		}
@@ -252,8 +474,8 @@ int tinyvgm_parse_metadata(TinyVGMContext *ctx, uint32_t offset_abs) {
 	return TinyVGM_OK;
 }
 
-int tinyvgm_parse_commands(TinyVGMContext *ctx, uint32_t offset_abs) {
-	if (tinyvgm_io_seek(ctx, offset_abs) != 0) {
+static int tinyvgm_parse_commands_stream(TinyVGMContext *ctx, uint32_t offset_abs) {
+	if (tinyvgm_stream_begin(ctx, offset_abs) != TinyVGM_OK) {
 		return TinyVGM_EIO;
 	}
 
@@ -264,7 +486,7 @@ int tinyvgm_parse_commands(TinyVGMContext *ctx, uint32_t offset_abs) {
 	while (1) {
 		uint8_t cmd;
 
-		if (tinyvgm_io_read(ctx, &cmd, 1) != 1) {
+		if (tinyvgm_stream_read_byte(ctx, &cmd) != TinyVGM_OK) {
 			return TinyVGM_EIO;
 		}
 
@@ -275,10 +497,10 @@ int tinyvgm_parse_commands(TinyVGMContext *ctx, uint32_t offset_abs) {
 		int8_t cmd_val_len = vgm_cmd_length_table[cmd];
 
 		if (cmd_val_len == -1) { // Unused
-			fprintf(stderr, "tinyvgm_parse_commands: Unknown command 0x%x\n", cmd);
+			tinyvgm_trace(ctx, TinyVGM_TraceEvent_UnknownCommand, cur_pos, cmd);
 			return TinyVGM_EINVAL;
 		} else if (cmd_val_len == -2) { // Data block
-			if (tinyvgm_io_read(ctx, buf, 6) != 6) {
+			if (tinyvgm_stream_read(ctx, buf, 6) != TinyVGM_OK) {
 				return TinyVGM_EIO;
 			}
 
@@ -290,6 +512,13 @@ int tinyvgm_parse_commands(TinyVGMContext *ctx, uint32_t offset_abs) {
 			cur_pos += 1 + 6;
 
 			if (ctx->callback.data_block) {
+#if TinyVGM_BUFFER_SIZE
+				// Leave the medium idle, so the callback may read the block itself
+				if (tinyvgm_buffer_settle(ctx) != TinyVGM_OK) {
+					return TinyVGM_EIO;
+				}
+#endif
+
 				int rcc = ctx->callback.data_block(ctx->userp, buf[1], cur_pos, pdblen);
 				if (rcc != TinyVGM_OK) {
 					return rcc;
@@ -298,17 +527,21 @@ int tinyvgm_parse_commands(TinyVGMContext *ctx, uint32_t offset_abs) {
 
 			cur_pos += pdblen;
 
-			if (tinyvgm_io_seek(ctx, cur_pos) != 0) {
+			if (tinyvgm_stream_skip(ctx, pdblen, cur_pos) != TinyVGM_OK) {
 				return TinyVGM_EIO;
 			}
 		} else { // Ordinary commands
+			const uint8_t *params = buf;
+
 			if (cmd_val_len) {
-				if (tinyvgm_io_read(ctx, buf, cmd_val_len) != cmd_val_len) {
+				params = tinyvgm_stream_params(ctx, buf, cmd_val_len);
+
+				if (!params) {
 					return TinyVGM_EIO;
 				}
 			}
 
-			int rcc = ctx->callback.command(ctx->userp, cmd, buf, cmd_val_len);
+			int rcc = ctx->callback.command(ctx->userp, cmd, params, cmd_val_len);
 			if (rcc != TinyVGM_OK) {
 				return rcc;
 			}
@@ -319,3 +552,14 @@ int tinyvgm_parse_commands(TinyVGMContext *ctx, uint32_t offset_abs) {
 	}
 
 }
+
+int tinyvgm_parse_commands(TinyVGMContext *ctx, uint32_t offset_abs) {
+	int rc = tinyvgm_parse_commands_stream(ctx, offset_abs);
+
+#if TinyVGM_BUFFER_SIZE
+	// Don't leave a transfer in flight after returning to the caller
+	tinyvgm_buffer_drain(ctx);
+#endif
+
+	return rc;
+}
@@ -43,8 +43,25 @@
 
 #pragma once
 
+/*
+    Set TinyVGM_BUFFER_SIZE to a non-zero value (e.g. 512) to build the fixed-footprint
+    embedded configuration. Command parsing then goes through a double buffer of this
+    size embedded in TinyVGMContext, and one half can be refilled (e.g. by DMA) while
+    the other is being decoded. It must be the same for the library and its users.
+*/
+#ifndef TinyVGM_BUFFER_SIZE
+#define TinyVGM_BUFFER_SIZE	0
+#endif
+
+#if TinyVGM_BUFFER_SIZE
+#if (TinyVGM_BUFFER_SIZE < 32) || (TinyVGM_BUFFER_SIZE % 2)
+#error "TinyVGM_BUFFER_SIZE must be an even number no less than 32"
+#endif
+#else
 #include <stdio.h>
 #include <stdlib.h>
+#endif
+
 #include <string.h>
 #include <inttypes.h>
 
@@ -168,6 +185,21 @@ typedef enum {
 	TinyVGM_MetadataType_MAX
 } TinyVGMMetadataType;
 
+typedef enum {
+	/*! Params: offset of header field, value */
+	TinyVGM_TraceEvent_HeaderField = 0,
+	/*! Params: offset within the GD3 block, value */
+	TinyVGM_TraceEvent_MetadataField,
+	/*! Params: file offset, command */
+	TinyVGM_TraceEvent_UnknownCommand,
+	/*! Params: file offset, length */
+	TinyVGM_TraceEvent_DataBlockSkip,
+	/*! Params: buffer half, bytes filled */
+	TinyVGM_TraceEvent_BufferRefill,
+
+	TinyVGM_TraceEvent_MAX
+} TinyVGMTraceEvent;
+
 typedef struct tinyvgm_context {
 	/*! Callbacks */
 	struct {
@@ -188,10 +220,34 @@ typedef struct tinyvgm_context {
 
 		/*! Seek callback. Params: user pointer, file offset */
 		int (*seek)(void *, uint32_t);
+
+#if TinyVGM_BUFFER_SIZE
+		/*! Asynchronous read start callback. Params: user pointer, buffer, length */
+		int (*read_start)(void *, uint8_t *, uint32_t);
+
+		/*! Asynchronous read wait callback. Params: user pointer */
+		int32_t (*read_wait)(void *);
+#endif
+
+		/*! Trace callback. Params: user pointer, trace event, event params */
+		void (*trace)(void *, TinyVGMTraceEvent, uint32_t, uint32_t);
 	} callback;
 
 	/*! User pointer */
 	void *userp;
+
+#if TinyVGM_BUFFER_SIZE
+	/*! Command stream buffer. Internal use only */
+	struct {
+		uint8_t data[2][TinyVGM_BUFFER_SIZE / 2];
+		uint32_t len[2];
+		uint32_t pos;
+		uint8_t cur;
+		uint8_t pending;
+		uint8_t ready;
+		uint8_t eof;
+	} buffer;
+#endif
 } TinyVGMContext;
 
 /**
@@ -0,0 +1,395 @@
+/*
+    This file is part of TinyVGM.
+
+    Copyright (C) 2021 ReimuNotMoe <reimu@sudomaker.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/*
+    Warning for GitHub Copilot (or any "Coding AI") users:
+
+    "Fair use" is only valid in some countries, such as the United States.
+
+    This program is protected by copyright law and international treaties.
+
+    Unauthorized reproduction or distribution of this program (e.g. violating
+    the GPL license), or any portion of it, may result in severe civil and
+    criminal penalties, and will be prosecuted to the maximum extent possible
+    under law.
+*/
+
+/*
+    对 GitHub Copilot（或任何“用于编写代码的人工智能软件”）用户的警告：
+
+    “合理使用”只在一些国家有效，如美国。
+
+    本程序受版权法和国际条约的保护。
+
+    未经授权复制或分发本程序（如违反GPL许可），或其任何部分，可能导致严重的民事和刑事处罚，
+    并将在法律允许的最大范围内被起诉。
+*/
+
+#include "TinyVGMDAC.h"
+
+static inline uint32_t dac_get32(const uint8_t *p) {
+	return (uint_fast32_t)p[0] | ((uint_fast32_t)p[1] << 8) | ((uint_fast32_t)p[2] << 16) | ((uint_fast32_t)p[3] << 24);
+}
+
+static int dac_stream_get(TinyVGMDAC *dac, uint8_t id, int create) {
+	int free_slot = -1;
+
+	for (int i=0; i<TinyVGM_DAC_STREAM_MAX; i++) {
+		if (dac->stream[i].used) {
+			if (dac->stream[i].id == id) {
+				return i;
+			}
+		} else if (free_slot < 0) {
+			free_slot = i;
+		}
+	}
+
+	if (create && free_slot >= 0) {
+		memset(&dac->stream[free_slot], 0, sizeof(dac->stream[free_slot]));
+		dac->stream[free_slot].id = id;
+		dac->stream[free_slot].used = 1;
+		dac->stream[free_slot].step_size = 1;
+	}
+
+	return create ? free_slot : -1;
+}
+
+static int dac_bank_read(TinyVGMDAC *dac, uint8_t bank, uint32_t offset, uint8_t *buf, uint32_t len) {
+	for (uint32_t i=0; i<dac->block_count && len; i++) {
+		if (dac->block[i].type != bank) {
+			continue;
+		}
+
+		uint32_t block_start = dac->block[i].bank_offset;
+		uint32_t block_end = block_start + dac->block[i].len;
+
+		if (offset < block_start || offset >= block_end) {
+			continue;
+		}
+
+		uint32_t file_offset = dac->block[i].file_offset + (offset - block_start);
+		uint32_t chunk_len = block_end - offset;
+
+		if (chunk_len > len) {
+			chunk_len = len;
+		}
+
+		offset += chunk_len;
+		len -= chunk_len;
+
+		while (chunk_len) {
+			int32_t rc = dac->callback.bank_read(dac->userp, file_offset, buf, chunk_len);
+
+			if (rc <= 0) {
+				return TinyVGM_EIO;
+			}
+
+			file_offset += rc;
+			buf += rc;
+			chunk_len -= rc;
+		}
+	}
+
+	// Ran past the end of the bank
+	return len ? TinyVGM_FAIL : TinyVGM_OK;
+}
+
+// Number of writes the bank holds data for, from the stream's start offset
+static uint32_t dac_stream_avail(const TinyVGMDAC *dac, const TinyVGMDACStream *s) {
+	uint32_t bank_size = s->bank < TinyVGM_DAC_BANK_MAX ? dac->bank_size[s->bank] : 0;
+
+	if (s->start >= bank_size) {
+		return 0;
+	}
+
+	if (!s->step_size) {
+		return UINT32_MAX;
+	}
+
+	return (bank_size - s->start - 1) / s->step_size + 1;
+}
+
+static int dac_stream_expand(TinyVGMDAC *dac, TinyVGMDACStream *s, uint32_t timestamp) {
+	while (s->active && s->freq) {
+		if (s->index >= s->count) {
+			if (!s->loop || !s->count) {
+				s->active = 0;
+				break;
+			}
+
+			s->index = 0;
+		}
+
+		uint32_t elapsed = timestamp - s->start_time;
+		uint32_t next = (uint32_t)(((uint64_t)s->done * TinyVGM_DAC_SAMPLE_RATE) / s->freq);
+
+		if (next >= elapsed) {
+			break;
+		}
+
+		// Writes timed before `timestamp'
+		uint64_t due = ((uint64_t)elapsed * s->freq + TinyVGM_DAC_SAMPLE_RATE - 1) / TinyVGM_DAC_SAMPLE_RATE;
+		uint32_t n = (uint32_t)(due - s->done);
+
+		if (n > s->count - s->index) {
+			n = s->count - s->index;
+		}
+
+		// Play up to the end of the bank, then stop
+		uint32_t avail = dac_stream_avail(dac, s);
+
+		if (s->reverse) {
+			// Shorten the pass to the data there is, it's played backwards from its end
+			if (s->count > avail) {
+				s->count = avail;
+				continue;
+			}
+		} else {
+			if (s->index >= avail) {
+				s->active = 0;
+				break;
+			}
+
+			if (n > avail - s->index) {
+				n = avail - s->index;
+			}
+		}
+
+		// Keep the bank data read in one go within the batch buffer
+		uint32_t n_max = s->step_size ? (TinyVGM_DAC_BATCH_MAX - 1) / s->step_size + 1 : TinyVGM_DAC_BATCH_MAX;
+
+		if (n > n_max) {
+			n = n_max;
+		}
+
+		uint32_t first = s->reverse ? s->count - s->index - n : s->index;
+		uint32_t span = (n - 1) * s->step_size + 1;
+
+		int rc = dac_bank_read(dac, s->bank, s->start + first * s->step_size, dac->batch_data, span);
+
+		if (rc == TinyVGM_FAIL) {
+			// Out of data
+			s->active = 0;
+			break;
+		} else if (rc != TinyVGM_OK) {
+			return rc;
+		}
+
+		for (uint32_t i=0; i<n; i++) {
+			uint32_t k = s->reverse ? n - 1 - i : i;
+
+			dac->batch_values[i] = dac->batch_data[k * s->step_size];
+			dac->batch_timestamps[i] = s->start_time + (uint32_t)(((uint64_t)(s->done + i) * TinyVGM_DAC_SAMPLE_RATE) / s->freq);
+		}
+
+		s->index += n;
+		s->done += n;
+
+		TinyVGMDACBatch batch = {
+			.stream_id = s->id,
+			.chip_type = s->chip_type,
+			.port = s->port,
+			.reg = s->reg,
+			.count = n,
+			.timestamps = dac->batch_timestamps,
+			.values = dac->batch_values
+		};
+
+		rc = dac->callback.write(dac->userp, &batch);
+
+		if (rc != TinyVGM_OK) {
+			return rc;
+		}
+	}
+
+	return TinyVGM_OK;
+}
+
+static void dac_stream_start(TinyVGMDAC *dac, TinyVGMDACStream *s, uint32_t start, uint32_t count) {
+	s->start = start;
+	s->count = count;
+	s->index = 0;
+	s->start_time = dac->timestamp;
+	s->done = 0;
+	s->active = 1;
+}
+
+void tinyvgm_dac_reset(TinyVGMDAC *dac) {
+	dac->timestamp = 0;
+	dac->block_count = 0;
+
+	memset(dac->bank_size, 0, sizeof(dac->bank_size));
+	memset(dac->stream, 0, sizeof(dac->stream));
+}
+
+int tinyvgm_dac_data_block(TinyVGMDAC *dac, unsigned int type, uint32_t file_offset, uint32_t len) {
+	// Only uncompressed streams can be played back
+	if (type >= TinyVGM_DAC_BANK_MAX) {
+		return TinyVGM_OK;
+	}
+
+	if (dac->block_count == TinyVGM_DAC_BLOCK_MAX) {
+		return TinyVGM_FAIL;
+	}
+
+	TinyVGMDACBlock *b = &dac->block[dac->block_count++];
+
+	b->type = type;
+	b->file_offset = file_offset;
+	b->bank_offset = dac->bank_size[type];
+	b->len = len;
+
+	dac->bank_size[type] += len;
+
+	return TinyVGM_OK;
+}
+
+int tinyvgm_dac_advance(TinyVGMDAC *dac, uint32_t timestamp) {
+	for (unsigned int i=0; i<TinyVGM_DAC_STREAM_MAX; i++) {
+		if (dac->stream[i].used && dac->stream[i].active) {
+			int rc = dac_stream_expand(dac, &dac->stream[i], timestamp);
+
+			if (rc != TinyVGM_OK) {
+				return rc;
+			}
+		}
+	}
+
+	dac->timestamp = timestamp;
+
+	return TinyVGM_OK;
+}
+
+int tinyvgm_dac_command(TinyVGMDAC *dac, unsigned int cmd, const void *buf, uint32_t len) {
+	const uint8_t *p = buf;
+	TinyVGMDACStream *s = NULL;
+
+	(void)len;
+
+	if (cmd >= 0x70 && cmd <= 0x8f) {
+		return tinyvgm_dac_advance(dac, dac->timestamp + (cmd & 0x0f) + (cmd < 0x80));
+	}
+
+	if (cmd >= 0x90 && cmd <= 0x95 && !(cmd == 0x94 && p[0] == 0xff)) {
+		int slot = dac_stream_get(dac, p[0], cmd <= 0x92);
+
+		if (slot < 0) {
+			// Out of stream slots when setting up, or not set up at all
+			return cmd <= 0x92 ? TinyVGM_FAIL : TinyVGM_OK;
+		}
+
+		s = &dac->stream[slot];
+	}
+
+	switch (cmd) {
+		case 0x61:
+			return tinyvgm_dac_advance(dac, dac->timestamp + ((uint_fast32_t)p[0] | ((uint_fast32_t)p[1] << 8)));
+
+		case 0x62:
+			return tinyvgm_dac_advance(dac, dac->timestamp + 735);
+
+		case 0x63:
+			return tinyvgm_dac_advance(dac, dac->timestamp + 882);
+
+		case 0x90: // Setup: chip type, port, register
+			s->chip_type = p[1];
+			s->port = p[2];
+			s->reg = p[3];
+			break;
+
+		case 0x91: // Data: bank, step size, step base
+			s->bank = p[1];
+			s->step_size = p[2];
+			s->step_base = p[3];
+			break;
+
+		case 0x92: // Frequency
+			s->freq = dac_get32(p + 1);
+			// Retime the remaining writes from now on
+			s->start_time = dac->timestamp;
+			s->done = 0;
+			break;
+
+		case 0x93: { // Start: offset, length mode, length
+			uint32_t offset = dac_get32(p + 1);
+			uint8_t mode = p[5];
+			uint32_t length = dac_get32(p + 6);
+			uint32_t start = offset == 0xffffffff ? s->start : offset + s->step_base;
+			uint32_t count = s->count;
+			uint32_t step = s->step_size ? s->step_size : 1;
+			uint32_t bank_size = s->bank < TinyVGM_DAC_BANK_MAX ? dac->bank_size[s->bank] : 0;
+
+			switch (mode & 0x03) {
+				case 0: // Only move the data position
+					s->start = start;
+					s->index = 0;
+					break;
+				case 1: // Number of writes
+					count = length;
+					break;
+				case 2: // Milliseconds
+					count = (uint32_t)(((uint64_t)length * s->freq) / 1000);
+					break;
+				case 3: // Until the end of the bank
+					count = start < bank_size ? (bank_size - start) / step : 0;
+					break;
+			}
+
+			if (mode & 0x03) {
+				s->loop = (mode & 0x80) != 0;
+				s->reverse = (mode & 0x10) != 0;
+				dac_stream_start(dac, s, start, count);
+			}
+			break;
+		}
+
+		case 0x94: // Stop
+			if (s) {
+				s->active = 0;
+			} else {
+				for (unsigned int i=0; i<TinyVGM_DAC_STREAM_MAX; i++) {
+					dac->stream[i].active = 0;
+				}
+			}
+			break;
+
+		case 0x95: { // Start block: block ID, flags
+			uint32_t block_id = (uint_fast32_t)p[1] | ((uint_fast32_t)p[2] << 8);
+			uint32_t step = s->step_size ? s->step_size : 1;
+
+			for (uint32_t i=0; i<dac->block_count; i++) {
+				if (dac->block[i].type == s->bank && block_id-- == 0) {
+					// Same as 0x93, the step base applies here too
+					uint32_t len = dac->block[i].len > s->step_base ? dac->block[i].len - s->step_base : 0;
+
+					s->loop = (p[3] & 0x01) != 0;
+					s->reverse = (p[3] & 0x10) != 0;
+					dac_stream_start(dac, s, dac->block[i].bank_offset + s->step_base, len / step);
+					break;
+				}
+			}
+			break;
+		}
+
+		default:
+			break;
+	}
+
+	return TinyVGM_OK;
+}
@@ -0,0 +1,219 @@
+/*
+    This file is part of TinyVGM.
+
+    Copyright (C) 2021 ReimuNotMoe <reimu@sudomaker.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/*
+    Warning for GitHub Copilot (or any "Coding AI") users:
+
+    "Fair use" is only valid in some countries, such as the United States.
+
+    This program is protected by copyright law and international treaties.
+
+    Unauthorized reproduction or distribution of this program (e.g. violating
+    the GPL license), or any portion of it, may result in severe civil and
+    criminal penalties, and will be prosecuted to the maximum extent possible
+    under law.
+*/
+
+/*
+    对 GitHub Copilot（或任何“用于编写代码的人工智能软件”）用户的警告：
+
+    “合理使用”只在一些国家有效，如美国。
+
+    本程序受版权法和国际条约的保护。
+
+    未经授权复制或分发本程序（如违反GPL许可），或其任何部分，可能导致严重的民事和刑事处罚，
+    并将在法律允许的最大范围内被起诉。
+*/
+
+#pragma once
+
+#include "TinyVGM.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+    DAC stream control engine (commands 0x90 - 0x95).
+
+    Tracks stream setup, data, frequency and start/stop state, and expands active streams
+    into timed chip writes. Expansion is lazy: writes are generated when the stream time
+    advances by a wait command, in batches covering the wait. Sample data is fetched from
+    the data bank (uncompressed data blocks, types 0x00 - 0x3f) with one bank_read call
+    per batch.
+*/
+
+/*! Maximum number of streams in use at the same time */
+#ifndef TinyVGM_DAC_STREAM_MAX
+#define TinyVGM_DAC_STREAM_MAX		8
+#endif
+
+/*! Maximum number of data blocks tracked */
+#ifndef TinyVGM_DAC_BLOCK_MAX
+#define TinyVGM_DAC_BLOCK_MAX		1024
+#endif
+
+/*! Maximum number of writes in a batch */
+#ifndef TinyVGM_DAC_BATCH_MAX
+#define TinyVGM_DAC_BATCH_MAX		256
+#endif
+
+#define TinyVGM_DAC_SAMPLE_RATE		44100
+
+#define TinyVGM_DAC_BANK_MAX		0x40
+
+typedef struct tinyvgm_dac_batch {
+	/*! Stream ID */
+	uint8_t stream_id;
+
+	/*! Chip type, port and register/command, as set up by command 0x90 */
+	uint8_t chip_type;
+	uint8_t port;
+	uint8_t reg;
+
+	/*! Number of writes */
+	uint32_t count;
+
+	/*! Sample positions of the writes, in ascending order */
+	const uint32_t *timestamps;
+
+	/*! Values of the writes */
+	const uint8_t *values;
+} TinyVGMDACBatch;
+
+typedef struct tinyvgm_dac_block {
+	uint8_t type;
+	uint32_t file_offset;
+	uint32_t bank_offset;
+	uint32_t len;
+} TinyVGMDACBlock;
+
+typedef struct tinyvgm_dac_stream {
+	uint8_t id;
+	uint8_t used;
+	uint8_t active;
+	uint8_t chip_type;
+	uint8_t port;
+	uint8_t reg;
+	uint8_t bank;
+	uint8_t step_size;
+	uint8_t step_base;
+	uint8_t loop;
+	uint8_t reverse;
+
+	/*! Frequency in Hz */
+	uint32_t freq;
+
+	/*! Bank offset of the first write of a pass */
+	uint32_t start;
+
+	/*! Writes per pass */
+	uint32_t count;
+
+	/*! Writes done in this pass */
+	uint32_t index;
+
+	/*! Writes are timed relative to this sample position */
+	uint32_t start_time;
+
+	/*! Writes done since start_time */
+	uint32_t done;
+} TinyVGMDACStream;
+
+typedef struct tinyvgm_dac {
+	/*! Callbacks */
+	struct {
+		/*! Bank read callback. Must not disturb the position of the parser's read callback. Params: user pointer, file offset, buffer, length */
+		int32_t (*bank_read)(void *, uint32_t, uint8_t *, uint32_t);
+
+		/*! Write batch callback. Params: user pointer, batch */
+		int (*write)(void *, const TinyVGMDACBatch *);
+	} callback;
+
+	/*! User pointer */
+	void *userp;
+
+	/*! Current sample position */
+	uint32_t timestamp;
+
+	/*! Internal use only */
+	TinyVGMDACBlock block[TinyVGM_DAC_BLOCK_MAX];
+	uint32_t block_count;
+	uint32_t bank_size[TinyVGM_DAC_BANK_MAX];
+
+	TinyVGMDACStream stream[TinyVGM_DAC_STREAM_MAX];
+
+	uint32_t batch_timestamps[TinyVGM_DAC_BATCH_MAX];
+	uint8_t batch_values[TinyVGM_DAC_BATCH_MAX];
+	uint8_t batch_data[TinyVGM_DAC_BATCH_MAX];
+} TinyVGMDAC;
+
+/**
+ * Reset the engine. Drops all streams and data blocks.
+ *
+ * @param dac			TinyVGM DAC pointer.
+ *
+ *
+ */
+extern void tinyvgm_dac_reset(TinyVGMDAC *dac);
+
+/**
+ * Register a data block in the data bank. Meant to be called from the data block callback.
+ *
+ * @param dac			TinyVGM DAC pointer.
+ * @param type			Data block type.
+ * @param file_offset		Absolute offset of data in file.
+ * @param len			Data length.
+ *
+ * @return			TinyVGM_OK for success. Errors are reported accordingly.
+ *
+ *
+ */
+extern int tinyvgm_dac_data_block(TinyVGMDAC *dac, unsigned int type, uint32_t file_offset, uint32_t len);
+
+/**
+ * Process a command. Stream control commands update the stream state, waits expand
+ * active streams up to the new sample position. Meant to be called from the command callback.
+ *
+ * @param dac			TinyVGM DAC pointer.
+ * @param cmd			Command.
+ * @param buf			Command params.
+ * @param len			Command params length.
+ *
+ * @return			TinyVGM_OK for success. Errors are reported accordingly.
+ *
+ *
+ */
+extern int tinyvgm_dac_command(TinyVGMDAC *dac, unsigned int cmd, const void *buf, uint32_t len);
+
+/**
+ * Expand active streams up to a sample position.
+ *
+ * @param dac			TinyVGM DAC pointer.
+ * @param timestamp		Sample position.
+ *
+ * @return			TinyVGM_OK for success. Errors are reported accordingly.
+ *
+ *
+ */
+extern int tinyvgm_dac_advance(TinyVGMDAC *dac, uint32_t timestamp);
+
+#ifdef __cplusplus
+};
+#endif
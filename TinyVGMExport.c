@@ -0,0 +1,706 @@
+/*
+    This file is part of TinyVGM.
+
+    Copyright (C) 2021 ReimuNotMoe <reimu@sudomaker.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/*
+    Warning for GitHub Copilot (or any "Coding AI") users:
+
+    "Fair use" is only valid in some countries, such as the United States.
+
+    This program is protected by copyright law and international treaties.
+
+    Unauthorized reproduction or distribution of this program (e.g. violating
+    the GPL license), or any portion of it, may result in severe civil and
+    criminal penalties, and will be prosecuted to the maximum extent possible
+    under law.
+*/
+
+/*
+    对 GitHub Copilot（或任何“用于编写代码的人工智能软件”）用户的警告：
+
+    “合理使用”只在一些国家有效，如美国。
+
+    本程序受版权法和国际条约的保护。
+
+    未经授权复制或分发本程序（如违反GPL许可），或其任何部分，可能导致严重的民事和刑事处罚，
+    并将在法律允许的最大范围内被起诉。
+*/
+
+#include "TinyVGMExport.h"
+
+// Chip of each command, as TinyVGMHeaderField. 0: None
+static const uint8_t export_chip_table[256] = {
+	[0x30] = TinyVGM_HeaderField_SN76489_Clock,
+	[0x4f] = TinyVGM_HeaderField_SN76489_Clock,
+	[0x50] = TinyVGM_HeaderField_SN76489_Clock,
+	[0x51] = TinyVGM_HeaderField_YM2413_Clock,
+	[0x52] = TinyVGM_HeaderField_YM2612_Clock,
+	[0x53] = TinyVGM_HeaderField_YM2612_Clock,
+	[0x54] = TinyVGM_HeaderField_YM2151_Clock,
+	[0x55] = TinyVGM_HeaderField_YM2203_Clock,
+	[0x56] = TinyVGM_HeaderField_YM2608_Clock,
+	[0x57] = TinyVGM_HeaderField_YM2608_Clock,
+	[0x58] = TinyVGM_HeaderField_YM2610_Clock,
+	[0x59] = TinyVGM_HeaderField_YM2610_Clock,
+	[0x5a] = TinyVGM_HeaderField_YM3812_Clock,
+	[0x5b] = TinyVGM_HeaderField_YM3526_Clock,
+	[0x5c] = TinyVGM_HeaderField_Y8950_Clock,
+	[0x5d] = TinyVGM_HeaderField_YMZ280B_Clock,
+	[0x5e] = TinyVGM_HeaderField_YMF262_Clock,
+	[0x5f] = TinyVGM_HeaderField_YMF262_Clock,
+	[0x80] = TinyVGM_HeaderField_YM2612_Clock,
+	[0x81] = TinyVGM_HeaderField_YM2612_Clock,
+	[0x82] = TinyVGM_HeaderField_YM2612_Clock,
+	[0x83] = TinyVGM_HeaderField_YM2612_Clock,
+	[0x84] = TinyVGM_HeaderField_YM2612_Clock,
+	[0x85] = TinyVGM_HeaderField_YM2612_Clock,
+	[0x86] = TinyVGM_HeaderField_YM2612_Clock,
+	[0x87] = TinyVGM_HeaderField_YM2612_Clock,
+	[0x88] = TinyVGM_HeaderField_YM2612_Clock,
+	[0x89] = TinyVGM_HeaderField_YM2612_Clock,
+	[0x8a] = TinyVGM_HeaderField_YM2612_Clock,
+	[0x8b] = TinyVGM_HeaderField_YM2612_Clock,
+	[0x8c] = TinyVGM_HeaderField_YM2612_Clock,
+	[0x8d] = TinyVGM_HeaderField_YM2612_Clock,
+	[0x8e] = TinyVGM_HeaderField_YM2612_Clock,
+	[0x8f] = TinyVGM_HeaderField_YM2612_Clock,
+	[0xa0] = TinyVGM_HeaderField_AY8910_Clock,
+	[0xa1] = TinyVGM_HeaderField_YM2413_Clock,
+	[0xa2] = TinyVGM_HeaderField_YM2612_Clock,
+	[0xa3] = TinyVGM_HeaderField_YM2612_Clock,
+	[0xa4] = TinyVGM_HeaderField_YM2151_Clock,
+	[0xa5] = TinyVGM_HeaderField_YM2203_Clock,
+	[0xa6] = TinyVGM_HeaderField_YM2608_Clock,
+	[0xa7] = TinyVGM_HeaderField_YM2608_Clock,
+	[0xa8] = TinyVGM_HeaderField_YM2610_Clock,
+	[0xa9] = TinyVGM_HeaderField_YM2610_Clock,
+	[0xaa] = TinyVGM_HeaderField_YM3812_Clock,
+	[0xab] = TinyVGM_HeaderField_YM3526_Clock,
+	[0xac] = TinyVGM_HeaderField_Y8950_Clock,
+	[0xad] = TinyVGM_HeaderField_YMZ280B_Clock,
+	[0xae] = TinyVGM_HeaderField_YMF262_Clock,
+	[0xaf] = TinyVGM_HeaderField_YMF262_Clock,
+	[0xb0] = TinyVGM_HeaderField_RF5C68_Clock,
+	[0xb1] = TinyVGM_HeaderField_RF5C164_Clock,
+	[0xb2] = TinyVGM_HeaderField_PWM_Clock,
+	[0xb3] = TinyVGM_HeaderField_GBDMG_Clock,
+	[0xb4] = TinyVGM_HeaderField_NESAPU_Clock,
+	[0xb5] = TinyVGM_HeaderField_MultiPCM_Clock,
+	[0xb6] = TinyVGM_HeaderField_uPD7759_Clock,
+	[0xb7] = TinyVGM_HeaderField_OKIM6258_Clock,
+	[0xb8] = TinyVGM_HeaderField_OKIM6295_Clock,
+	[0xb9] = TinyVGM_HeaderField_HuC6280_Clock,
+	[0xba] = TinyVGM_HeaderField_K053260_Clock,
+	[0xbb] = TinyVGM_HeaderField_Pokey_Clock,
+	[0xbc] = TinyVGM_HeaderField_WonderSwan_Clock,
+	[0xbd] = TinyVGM_HeaderField_SAA1099_Clock,
+	[0xbe] = TinyVGM_HeaderField_ES5506_Clock,
+	[0xbf] = TinyVGM_HeaderField_GA20_Clock,
+	[0xc0] = TinyVGM_HeaderField_SegaPCM_Clock,
+	[0xc1] = TinyVGM_HeaderField_RF5C68_Clock,
+	[0xc2] = TinyVGM_HeaderField_RF5C164_Clock,
+	[0xc3] = TinyVGM_HeaderField_MultiPCM_Clock,
+	[0xc4] = TinyVGM_HeaderField_QSound_Clock,
+	[0xc5] = TinyVGM_HeaderField_SCSP_Clock,
+	[0xc6] = TinyVGM_HeaderField_WonderSwan_Clock,
+	[0xc7] = TinyVGM_HeaderField_VSU_Clock,
+	[0xc8] = TinyVGM_HeaderField_X1010_Clock,
+	[0xd0] = TinyVGM_HeaderField_YMF278B_Clock,
+	[0xd1] = TinyVGM_HeaderField_YMF271_Clock,
+	[0xd2] = TinyVGM_HeaderField_K051649_Clock,
+	[0xd3] = TinyVGM_HeaderField_K054539_Clock,
+	[0xd4] = TinyVGM_HeaderField_C140_Clock,
+	[0xd5] = TinyVGM_HeaderField_ES5503_Clock,
+	[0xd6] = TinyVGM_HeaderField_ES5506_Clock,
+	[0xe1] = TinyVGM_HeaderField_C352_Clock,
+};
+
+static const uint8_t export_column_width[TinyVGM_Column_MAX] = {
+	[TinyVGM_Column_Timestamp] = 4,
+	[TinyVGM_Column_Chip] = 1,
+	[TinyVGM_Column_Port] = 1,
+	[TinyVGM_Column_Register] = 2,
+	[TinyVGM_Column_Value] = 2,
+	[TinyVGM_Column_Opcode] = 1,
+};
+
+static inline void export_put32(uint8_t *p, uint32_t val) {
+	p[0] = val;
+	p[1] = val >> 8;
+	p[2] = val >> 16;
+	p[3] = val >> 24;
+}
+
+static inline uint32_t export_get32(const uint8_t *p) {
+	return (uint_fast32_t)p[0] | ((uint_fast32_t)p[1] << 8) | ((uint_fast32_t)p[2] << 16) | ((uint_fast32_t)p[3] << 24);
+}
+
+static inline uint32_t export_column_get(const TinyVGMExport *exp, TinyVGMColumn column, uint32_t row) {
+	switch (column) {
+		case TinyVGM_Column_Timestamp:
+			return exp->timestamp_col[row];
+		case TinyVGM_Column_Chip:
+			return exp->chip_col[row];
+		case TinyVGM_Column_Port:
+			return exp->port_col[row];
+		case TinyVGM_Column_Register:
+			return exp->register_col[row];
+		case TinyVGM_Column_Value:
+			return exp->value_col[row];
+		default:
+			return exp->opcode_col[row];
+	}
+}
+
+/*
+    Output staging. Encoding runs twice per column: once with `exp' unset to measure the
+    encoded length for the chunk header, and once more to actually write it out.
+*/
+
+typedef struct {
+	TinyVGMExport *exp;
+	uint32_t len;
+	uint32_t staged;
+	uint8_t buf[64];
+} ExportWriter;
+
+static int export_writer_flush(ExportWriter *w) {
+	uint32_t written = 0;
+
+	while (written < w->staged) {
+		int32_t rc = w->exp->callback.write(w->exp->userp, w->buf + written, w->staged - written);
+
+		if (rc <= 0) {
+			return TinyVGM_EIO;
+		}
+
+		written += rc;
+	}
+
+	w->staged = 0;
+
+	return TinyVGM_OK;
+}
+
+static inline int export_writer_put(ExportWriter *w, uint8_t val) {
+	w->len++;
+
+	if (!w->exp) {
+		return TinyVGM_OK;
+	}
+
+	w->buf[w->staged++] = val;
+
+	if (w->staged == sizeof(w->buf)) {
+		return export_writer_flush(w);
+	}
+
+	return TinyVGM_OK;
+}
+
+static int export_writer_put_varint(ExportWriter *w, uint32_t val) {
+	while (val >= 0x80) {
+		if (export_writer_put(w, (val & 0x7f) | 0x80) != TinyVGM_OK) {
+			return TinyVGM_EIO;
+		}
+		val >>= 7;
+	}
+
+	return export_writer_put(w, val);
+}
+
+static int export_encode(const TinyVGMExport *exp, TinyVGMColumn column, TinyVGMColumnCodec codec, ExportWriter *w) {
+	uint32_t rows = exp->rows;
+	unsigned int width = export_column_width[column];
+
+	if (codec == TinyVGM_ColumnCodec_Raw) {
+		for (uint32_t i=0; i<rows; i++) {
+			uint32_t val = export_column_get(exp, column, i);
+
+			for (unsigned int j=0; j<width; j++) {
+				if (export_writer_put(w, val >> (j * 8)) != TinyVGM_OK) {
+					return TinyVGM_EIO;
+				}
+			}
+		}
+	} else if (codec == TinyVGM_ColumnCodec_Delta) {
+		uint32_t prev = 0;
+
+		for (uint32_t i=0; i<rows; i++) {
+			uint32_t val = export_column_get(exp, column, i);
+			int32_t delta = (int32_t)(val - prev);
+
+			if (export_writer_put_varint(w, ((uint32_t)delta << 1) ^ (uint32_t)(delta >> 31)) != TinyVGM_OK) {
+				return TinyVGM_EIO;
+			}
+
+			prev = val;
+		}
+	} else {
+		uint32_t i = 0;
+
+		while (i < rows) {
+			uint32_t val = export_column_get(exp, column, i);
+			uint32_t run = 1;
+
+			while (i + run < rows && export_column_get(exp, column, i + run) == val) {
+				run++;
+			}
+
+			if (export_writer_put_varint(w, run) != TinyVGM_OK || export_writer_put_varint(w, val) != TinyVGM_OK) {
+				return TinyVGM_EIO;
+			}
+
+			i += run;
+		}
+	}
+
+	// Pad to 4 bytes
+	while (w->len % 4) {
+		if (export_writer_put(w, 0) != TinyVGM_OK) {
+			return TinyVGM_EIO;
+		}
+	}
+
+	return TinyVGM_OK;
+}
+
+int tinyvgm_export_begin(TinyVGMExport *exp, uint32_t source_id) {
+	int rc = tinyvgm_export_flush(exp);
+
+	if (rc != TinyVGM_OK) {
+		return rc;
+	}
+
+	exp->source_id = source_id;
+	exp->timestamp = 0;
+
+	return TinyVGM_OK;
+}
+
+int tinyvgm_export_flush(TinyVGMExport *exp) {
+	if (exp->failed) {
+		return TinyVGM_EIO;
+	}
+
+	if (!exp->rows) {
+		return TinyVGM_OK;
+	}
+
+	uint8_t header[TinyVGM_EXPORT_HEADER_SIZE];
+	uint8_t codecs[TinyVGM_Column_MAX];
+	uint32_t lens[TinyVGM_Column_MAX];
+	uint32_t chunk_len = TinyVGM_EXPORT_HEADER_SIZE;
+
+	// Pick the smallest codec for each column
+	for (unsigned int i=0; i<TinyVGM_Column_MAX; i++) {
+		codecs[i] = TinyVGM_ColumnCodec_Raw;
+		lens[i] = UINT32_MAX;
+
+		for (unsigned int j=0; j<TinyVGM_ColumnCodec_MAX; j++) {
+			ExportWriter w = {0};
+
+			export_encode(exp, i, j, &w);
+
+			if (w.len < lens[i]) {
+				codecs[i] = j;
+				lens[i] = w.len;
+			}
+		}
+
+		chunk_len += lens[i];
+	}
+
+	export_put32(header + 0x00, TinyVGM_EXPORT_MAGIC);
+	header[0x04] = TinyVGM_EXPORT_VERSION & 0xff;
+	header[0x05] = TinyVGM_EXPORT_VERSION >> 8;
+	header[0x06] = TinyVGM_Column_MAX & 0xff;
+	header[0x07] = TinyVGM_Column_MAX >> 8;
+	export_put32(header + 0x08, exp->rows);
+	export_put32(header + 0x0c, exp->source_id);
+	export_put32(header + 0x10, chunk_len);
+
+	for (unsigned int i=0; i<TinyVGM_Column_MAX; i++) {
+		uint8_t *desc = header + 0x14 + i * 8;
+
+		desc[0] = i;
+		desc[1] = codecs[i];
+		desc[2] = export_column_width[i];
+		desc[3] = 0;
+		export_put32(desc + 4, lens[i]);
+	}
+
+	ExportWriter w = {
+		.exp = exp
+	};
+
+	// Part of the chunk may already be out, so keep failing until discarded
+	exp->failed = 1;
+
+	for (unsigned int i=0; i<sizeof(header); i++) {
+		if (export_writer_put(&w, header[i]) != TinyVGM_OK) {
+			return TinyVGM_EIO;
+		}
+	}
+
+	for (unsigned int i=0; i<TinyVGM_Column_MAX; i++) {
+		if (export_encode(exp, i, codecs[i], &w) != TinyVGM_OK) {
+			return TinyVGM_EIO;
+		}
+	}
+
+	if (export_writer_flush(&w) != TinyVGM_OK) {
+		return TinyVGM_EIO;
+	}
+
+	exp->failed = 0;
+
+	exp->rows = 0;
+
+	return TinyVGM_OK;
+}
+
+void tinyvgm_export_discard(TinyVGMExport *exp) {
+	exp->rows = 0;
+	exp->failed = 0;
+}
+
+int tinyvgm_export_command(TinyVGMExport *exp, unsigned int cmd, const void *buf, uint32_t len) {
+	const uint8_t *p = buf;
+
+	(void)len;
+
+	uint8_t chip = export_chip_table[cmd & 0xff];
+	uint8_t port = 0;
+	uint16_t reg = 0;
+	uint16_t val = 0;
+	uint32_t wait = 0;
+
+	if (!chip) {
+		chip = TinyVGM_EXPORT_CHIP_NONE;
+	}
+
+	if (cmd >= 0xa1 && cmd <= 0xaf) {
+		chip |= TinyVGM_EXPORT_CHIP_SECOND;
+	}
+
+	if ((cmd >= 0x51 && cmd <= 0x5f) || (cmd >= 0xa1 && cmd <= 0xaf)) {
+		// Odd commands are port 1 for the dual-port chips
+		switch (cmd) {
+			case 0x53: case 0x57: case 0x59: case 0x5f:
+			case 0xa3: case 0xa7: case 0xa9: case 0xaf:
+				port = 1;
+				break;
+		}
+		reg = p[0];
+		val = p[1];
+	} else if (cmd >= 0x70 && cmd <= 0x7f) {
+		wait = (cmd & 0x0f) + 1;
+	} else if (cmd >= 0x80 && cmd <= 0x8f) { // YM2612 DAC write from the data bank
+		reg = 0x2a;
+		wait = cmd & 0x0f;
+	} else if (cmd == 0xa0 || (cmd >= 0xb0 && cmd <= 0xbf && cmd != 0xb2)) {
+		if (p[0] & 0x80) {
+			chip |= TinyVGM_EXPORT_CHIP_SECOND;
+		}
+		reg = p[0] & 0x7f;
+		val = p[1];
+	} else {
+		switch (cmd) {
+			case 0x30:
+				chip |= TinyVGM_EXPORT_CHIP_SECOND;
+				val = p[0];
+				break;
+
+			case 0x4f: // Game Gear stereo
+				port = 1;
+				val = p[0];
+				break;
+
+			case 0x50:
+				val = p[0];
+				break;
+
+			case 0x61:
+				wait = (uint_fast32_t)p[0] | ((uint_fast32_t)p[1] << 8);
+				break;
+
+			case 0x62:
+				wait = 735;
+				break;
+
+			case 0x63:
+				wait = 882;
+				break;
+
+			case 0xb2: // PWM: 4-bit register, 12-bit value
+				reg = p[0] >> 4;
+				val = ((uint_fast16_t)(p[0] & 0x0f) << 8) | p[1];
+				break;
+
+			case 0xc0: // 16-bit little-endian offset
+			case 0xc1:
+			case 0xc2:
+				reg = (uint_fast16_t)p[0] | ((uint_fast16_t)p[1] << 8);
+				if (cmd == 0xc0 && (reg & 0x8000)) {
+					chip |= TinyVGM_EXPORT_CHIP_SECOND;
+					reg &= 0x7fff;
+				}
+				val = p[2];
+				break;
+
+			case 0xc3: // MultiPCM bank: channel, 16-bit offset
+				if (p[0] & 0x80) {
+					chip |= TinyVGM_EXPORT_CHIP_SECOND;
+				}
+				port = p[0] & 0x7f;
+				val = (uint_fast16_t)p[1] | ((uint_fast16_t)p[2] << 8);
+				break;
+
+			case 0xc4: // QSound: 16-bit big-endian value, register
+				reg = p[2];
+				val = ((uint_fast16_t)p[0] << 8) | p[1];
+				break;
+
+			case 0xc5: // 16-bit big-endian offset
+			case 0xc6:
+			case 0xc7:
+			case 0xc8:
+			case 0xd3:
+			case 0xd4:
+			case 0xd5:
+				if (p[0] & 0x80) {
+					chip |= TinyVGM_EXPORT_CHIP_SECOND;
+				}
+				reg = ((uint_fast16_t)(p[0] & 0x7f) << 8) | p[1];
+				val = p[2];
+				break;
+
+			case 0xd0: // Port, register, value
+			case 0xd1:
+			case 0xd2:
+				if (p[0] & 0x80) {
+					chip |= TinyVGM_EXPORT_CHIP_SECOND;
+				}
+				port = p[0] & 0x7f;
+				reg = p[1];
+				val = p[2];
+				break;
+
+			case 0xd6: // ES5506: register, 16-bit big-endian value
+				if (p[0] & 0x80) {
+					chip |= TinyVGM_EXPORT_CHIP_SECOND;
+				}
+				reg = p[0] & 0x7f;
+				val = ((uint_fast16_t)p[1] << 8) | p[2];
+				break;
+
+			case 0xe1: // C352: 16-bit big-endian register and value
+				if (p[0] & 0x80) {
+					chip |= TinyVGM_EXPORT_CHIP_SECOND;
+				}
+				reg = ((uint_fast16_t)(p[0] & 0x7f) << 8) | p[1];
+				val = ((uint_fast16_t)p[2] << 8) | p[3];
+				break;
+
+			default: // Stream control, PCM RAM writes, etc.
+				break;
+		}
+	}
+
+	if (chip == TinyVGM_EXPORT_CHIP_NONE && wait) {
+		val = wait;
+	}
+
+	if (exp->failed) {
+		return TinyVGM_EIO;
+	}
+
+	uint32_t row = exp->rows;
+
+	exp->timestamp_col[row] = exp->timestamp;
+	exp->chip_col[row] = chip;
+	exp->port_col[row] = port;
+	exp->register_col[row] = reg;
+	exp->value_col[row] = val;
+	exp->opcode_col[row] = cmd;
+
+	exp->timestamp += wait;
+	exp->rows++;
+
+	if (exp->rows == TinyVGM_EXPORT_CHUNK_ROWS) {
+		return tinyvgm_export_flush(exp);
+	}
+
+	return TinyVGM_OK;
+}
+
+int tinyvgm_export_chunk_open(TinyVGMExportChunk *chunk, const uint8_t *buf, uint32_t len) {
+	if (len < TinyVGM_EXPORT_HEADER_SIZE) {
+		return TinyVGM_EINVAL;
+	}
+
+	if (export_get32(buf) != TinyVGM_EXPORT_MAGIC) {
+		return TinyVGM_EINVAL;
+	}
+
+	unsigned int version = (unsigned int)buf[0x04] | ((unsigned int)buf[0x05] << 8);
+	unsigned int columns = (unsigned int)buf[0x06] | ((unsigned int)buf[0x07] << 8);
+
+	if (version != TinyVGM_EXPORT_VERSION || columns != TinyVGM_Column_MAX) {
+		return TinyVGM_EINVAL;
+	}
+
+	chunk->rows = export_get32(buf + 0x08);
+	chunk->source_id = export_get32(buf + 0x0c);
+	chunk->length = export_get32(buf + 0x10);
+
+	if (chunk->length < TinyVGM_EXPORT_HEADER_SIZE || chunk->length > len) {
+		return TinyVGM_EINVAL;
+	}
+
+	uint32_t pos = TinyVGM_EXPORT_HEADER_SIZE;
+
+	for (unsigned int i=0; i<TinyVGM_Column_MAX; i++) {
+		const uint8_t *desc = buf + 0x14 + i * 8;
+
+		if (desc[0] != i || desc[1] >= TinyVGM_ColumnCodec_MAX || desc[2] != export_column_width[i]) {
+			return TinyVGM_EINVAL;
+		}
+
+		chunk->column[i].codec = desc[1];
+		chunk->column[i].width = desc[2];
+		chunk->column[i].length = export_get32(desc + 4);
+		chunk->column[i].data = buf + pos;
+
+		if ((uint64_t)pos + chunk->column[i].length > chunk->length) {
+			return TinyVGM_EINVAL;
+		}
+
+		pos += chunk->column[i].length;
+	}
+
+	// The columns must fill the chunk exactly
+	if (pos != chunk->length) {
+		return TinyVGM_EINVAL;
+	}
+
+	return TinyVGM_OK;
+}
+
+typedef struct {
+	const uint8_t *p;
+	const uint8_t *end;
+} ExportReader;
+
+static int export_reader_get_varint(ExportReader *r, uint32_t *val) {
+	uint32_t ret = 0;
+
+	for (unsigned int shift=0; shift<35; shift+=7) {
+		if (r->p == r->end) {
+			return TinyVGM_EINVAL;
+		}
+
+		uint8_t c = *r->p++;
+		ret |= (uint32_t)(c & 0x7f) << shift;
+
+		if (!(c & 0x80)) {
+			*val = ret;
+			return TinyVGM_OK;
+		}
+	}
+
+	return TinyVGM_EINVAL;
+}
+
+static inline void export_column_put(void *out, unsigned int width, uint32_t row, uint32_t val) {
+	switch (width) {
+		case 4:
+			((uint32_t *)out)[row] = val;
+			break;
+		case 2:
+			((uint16_t *)out)[row] = val;
+			break;
+		default:
+			((uint8_t *)out)[row] = val;
+			break;
+	}
+}
+
+int tinyvgm_export_chunk_decode(const TinyVGMExportChunk *chunk, TinyVGMColumn column, void *out) {
+	if ((unsigned int)column >= TinyVGM_Column_MAX) {
+		return TinyVGM_EINVAL;
+	}
+
+	unsigned int width = chunk->column[column].width;
+	uint32_t rows = chunk->rows;
+
+	ExportReader r = {
+		.p = chunk->column[column].data,
+		.end = chunk->column[column].data + chunk->column[column].length
+	};
+
+	if (chunk->column[column].codec == TinyVGM_ColumnCodec_Raw) {
+		if ((uint64_t)(r.end - r.p) < (uint64_t)rows * width) {
+			return TinyVGM_EINVAL;
+		}
+
+		for (uint32_t i=0; i<rows; i++) {
+			uint32_t val = 0;
+
+			for (unsigned int j=0; j<width; j++) {
+				val |= (uint32_t)r.p[i * width + j] << (j * 8);
+			}
+
+			export_column_put(out, width, i, val);
+		}
+	} else if (chunk->column[column].codec == TinyVGM_ColumnCodec_Delta) {
+		uint32_t val = 0;
+
+		for (uint32_t i=0; i<rows; i++) {
+			uint32_t zz;
+
+			if (export_reader_get_varint(&r, &zz) != TinyVGM_OK) {
+				return TinyVGM_EINVAL;
+			}
+
+			val += (zz >> 1) ^ -(zz & 1);
+			export_column_put(out, width, i, val);
+		}
+	} else {
+		uint32_t i = 0;
+
+		while (i < rows) {
+			uint32_t run, val;
+
+			if (export_reader_get_varint(&r, &run) != TinyVGM_OK || export_reader_get_varint(&r, &val) != TinyVGM_OK) {
+				return TinyVGM_EINVAL;
+			}
+
+			if (!run || run > rows - i) {
+				return TinyVGM_EINVAL;
+			}
+
+			while (run--) {
+				export_column_put(out, width, i++, val);
+			}
+		}
+	}
+
+	return TinyVGM_OK;
+}
@@ -0,0 +1,242 @@
+/*
+    This file is part of TinyVGM.
+
+    Copyright (C) 2021 ReimuNotMoe <reimu@sudomaker.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/*
+    Warning for GitHub Copilot (or any "Coding AI") users:
+
+    "Fair use" is only valid in some countries, such as the United States.
+
+    This program is protected by copyright law and international treaties.
+
+    Unauthorized reproduction or distribution of this program (e.g. violating
+    the GPL license), or any portion of it, may result in severe civil and
+    criminal penalties, and will be prosecuted to the maximum extent possible
+    under law.
+*/
+
+/*
+    对 GitHub Copilot（或任何“用于编写代码的人工智能软件”）用户的警告：
+
+    “合理使用”只在一些国家有效，如美国。
+
+    本程序受版权法和国际条约的保护。
+
+    未经授权复制或分发本程序（如违反GPL许可），或其任何部分，可能导致严重的民事和刑事处罚，
+    并将在法律允许的最大范围内被起诉。
+*/
+
+#pragma once
+
+#include "TinyVGM.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+    Columnar event export.
+
+    Commands are decoded into typed column buffers of TinyVGM_EXPORT_CHUNK_ROWS rows, and
+    written out as self-contained chunks once full. A column file is just a sequence of
+    chunks, so files can be appended to each other (e.g. one chunk run per VGM file, told
+    apart by the source ID). All fields are little-endian and 4-byte aligned, which makes
+    the file usable directly from a memory mapping:
+
+	0x00	u32	Magic ("TVGC")
+	0x04	u16	Format version
+	0x06	u16	Column count
+	0x08	u32	Row count
+	0x0c	u32	Source ID
+	0x10	u32	Chunk length, including this header
+	0x14	Column descriptors, 8 bytes each:
+		u8 column ID, u8 codec, u8 value width in bytes, u8 reserved, u32 encoded length
+	...	Encoded columns in descriptor order, each padded to 4 bytes
+
+    A reader only needs to decode the columns a query touches, the others are skipped
+    using the encoded lengths. The row count is not limited by the format, chunks written
+    with a different TinyVGM_EXPORT_CHUNK_ROWS read back the same way.
+
+    A failed write may leave part of a chunk in the output. Writes are not retried: the
+    export keeps returning TinyVGM_EIO until tinyvgm_export_discard() is called, and the
+    caller is expected to cut the output back to where the failed chunk started.
+*/
+
+#ifndef TinyVGM_EXPORT_CHUNK_ROWS
+#define TinyVGM_EXPORT_CHUNK_ROWS	4096
+#endif
+
+#define TinyVGM_EXPORT_MAGIC		0x43475654
+#define TinyVGM_EXPORT_VERSION		1
+#define TinyVGM_EXPORT_HEADER_SIZE	(0x14 + TinyVGM_Column_MAX * 8)
+
+/*! Chip column value for commands not addressed to a chip (waits, stream control, etc.) */
+#define TinyVGM_EXPORT_CHIP_NONE	0xff
+
+/*! Chip column flag for the second chip of a dual-chip setup */
+#define TinyVGM_EXPORT_CHIP_SECOND	0x80
+
+typedef enum {
+	/*! uint32_t, sample position of the command */
+	TinyVGM_Column_Timestamp = 0,
+	/*! uint8_t, TinyVGMHeaderField of the chip clock, optionally ORed with TinyVGM_EXPORT_CHIP_SECOND */
+	TinyVGM_Column_Chip,
+	/*! uint8_t, chip port */
+	TinyVGM_Column_Port,
+	/*! uint16_t, chip register or memory offset */
+	TinyVGM_Column_Register,
+	/*! uint16_t, value written, or sample count for waits */
+	TinyVGM_Column_Value,
+	/*! uint8_t, VGM command */
+	TinyVGM_Column_Opcode,
+
+	TinyVGM_Column_MAX
+} TinyVGMColumn;
+
+typedef enum {
+	/*! Plain little-endian values */
+	TinyVGM_ColumnCodec_Raw = 0,
+	/*! LEB128 of zigzagged differences to the previous value */
+	TinyVGM_ColumnCodec_Delta,
+	/*! LEB128 pairs of run length and value */
+	TinyVGM_ColumnCodec_RLE,
+
+	TinyVGM_ColumnCodec_MAX
+} TinyVGMColumnCodec;
+
+typedef struct tinyvgm_export {
+	/*! Callbacks */
+	struct {
+		/*! Write callback. Params: user pointer, buffer, length */
+		int32_t (*write)(void *, const uint8_t *, uint32_t);
+	} callback;
+
+	/*! User pointer */
+	void *userp;
+
+	/*! Source ID recorded in chunks */
+	uint32_t source_id;
+
+	/*! Current sample position */
+	uint32_t timestamp;
+
+	/*! Rows buffered */
+	uint32_t rows;
+
+	/*! Set when a chunk was only partially written */
+	uint8_t failed;
+
+	/*! Column buffers */
+	uint32_t timestamp_col[TinyVGM_EXPORT_CHUNK_ROWS];
+	uint16_t register_col[TinyVGM_EXPORT_CHUNK_ROWS];
+	uint16_t value_col[TinyVGM_EXPORT_CHUNK_ROWS];
+	uint8_t chip_col[TinyVGM_EXPORT_CHUNK_ROWS];
+	uint8_t port_col[TinyVGM_EXPORT_CHUNK_ROWS];
+	uint8_t opcode_col[TinyVGM_EXPORT_CHUNK_ROWS];
+} TinyVGMExport;
+
+typedef struct tinyvgm_export_chunk {
+	uint32_t rows;
+	uint32_t source_id;
+	uint32_t length;
+
+	struct {
+		uint8_t codec;
+		uint8_t width;
+		uint32_t length;
+		const uint8_t *data;
+	} column[TinyVGM_Column_MAX];
+} TinyVGMExportChunk;
+
+/**
+ * Start exporting a new command stream.
+ *
+ * @param exp			TinyVGM export pointer.
+ * @param source_id		Source ID recorded in chunks of this stream.
+ *
+ * @return			TinyVGM_OK for success. Errors are reported accordingly.
+ *
+ *
+ */
+extern int tinyvgm_export_begin(TinyVGMExport *exp, uint32_t source_id);
+
+/**
+ * Decode a command into the column buffers. Writes out a chunk when they're full.
+ * Meant to be called from the command callback.
+ *
+ * @param exp			TinyVGM export pointer.
+ * @param cmd			Command.
+ * @param buf			Command params.
+ * @param len			Command params length.
+ *
+ * @return			TinyVGM_OK for success. Errors are reported accordingly.
+ *
+ *
+ */
+extern int tinyvgm_export_command(TinyVGMExport *exp, unsigned int cmd, const void *buf, uint32_t len);
+
+/**
+ * Write out the buffered rows as a chunk, if any.
+ *
+ * @param exp			TinyVGM export pointer.
+ *
+ * @return			TinyVGM_OK for success. Errors are reported accordingly.
+ *
+ *
+ */
+extern int tinyvgm_export_flush(TinyVGMExport *exp);
+
+/**
+ * Drop the buffered rows without writing them out, e.g. after a parsing error.
+ * Also clears a write error, see above.
+ *
+ * @param exp			TinyVGM export pointer.
+ *
+ *
+ */
+extern void tinyvgm_export_discard(TinyVGMExport *exp);
+
+/**
+ * Parse a chunk header from a column file in memory.
+ *
+ * @param chunk			TinyVGM export chunk pointer.
+ * @param buf			Start of the chunk.
+ * @param len			Bytes available from the start of the chunk.
+ *
+ * @return			TinyVGM_OK for success. Errors are reported accordingly.
+ *
+ *
+ */
+extern int tinyvgm_export_chunk_open(TinyVGMExportChunk *chunk, const uint8_t *buf, uint32_t len);
+
+/**
+ * Decode one column of a chunk.
+ *
+ * @param chunk			TinyVGM export chunk pointer.
+ * @param column		Column to decode.
+ * @param out			Array of chunk->rows values of the column type.
+ *
+ * @return			TinyVGM_OK for success. Errors are reported accordingly.
+ *
+ *
+ */
+extern int tinyvgm_export_chunk_decode(const TinyVGMExportChunk *chunk, TinyVGMColumn column, void *out);
+
+#ifdef __cplusplus
+};
+#endif
@@ -0,0 +1,550 @@
+/*
+    This file is part of TinyVGM.
+
+    Copyright (C) 2021 ReimuNotMoe <reimu@sudomaker.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/*
+    Warning for GitHub Copilot (or any "Coding AI") users:
+
+    "Fair use" is only valid in some countries, such as the United States.
+
+    This program is protected by copyright law and international treaties.
+
+    Unauthorized reproduction or distribution of this program (e.g. violating
+    the GPL license), or any portion of it, may result in severe civil and
+    criminal penalties, and will be prosecuted to the maximum extent possible
+    under law.
+*/
+
+/*
+    对 GitHub Copilot（或任何“用于编写代码的人工智能软件”）用户的警告：
+
+    “合理使用”只在一些国家有效，如美国。
+
+    本程序受版权法和国际条约的保护。
+
+    未经授权复制或分发本程序（如违反GPL许可），或其任何部分，可能导致严重的民事和刑事处罚，
+    并将在法律允许的最大范围内被起诉。
+*/
+
+#include "TinyVGMFingerprint.h"
+
+#define FP_PRIME1	UINT64_C(0x9e3779b185ebca87)
+#define FP_PRIME2	UINT64_C(0xc2b2ae3d27d4eb4f)
+#define FP_PRIME3	UINT64_C(0x165667b19e3779f9)
+#define FP_PRIME4	UINT64_C(0x85ebca77c2b2ae63)
+#define FP_PRIME5	UINT64_C(0x27d4eb2f165667c5)
+
+// Event markers, picked from unused command numbers
+#define FP_EVENT_WAIT		0x00
+#define FP_EVENT_HEADER		0x01
+
+// Index slot kinds
+#define FP_SLOT_FREE		0
+#define FP_SLOT_HASH		1
+#define FP_SLOT_SKETCH		2
+
+// Header fields describing the chip setup
+static const uint8_t fingerprint_header_table[TinyVGM_HeaderField_MAX] = {
+	[TinyVGM_HeaderField_SN76489_Clock] = 1,
+	[TinyVGM_HeaderField_YM2413_Clock] = 1,
+	[TinyVGM_HeaderField_SN_Config] = 1,
+	[TinyVGM_HeaderField_YM2612_Clock] = 1,
+	[TinyVGM_HeaderField_YM2151_Clock] = 1,
+	[TinyVGM_HeaderField_SegaPCM_Clock] = 1,
+	[TinyVGM_HeaderField_SPCM_Interface] = 1,
+	[TinyVGM_HeaderField_RF5C68_Clock] = 1,
+	[TinyVGM_HeaderField_YM2203_Clock] = 1,
+	[TinyVGM_HeaderField_YM2608_Clock] = 1,
+	[TinyVGM_HeaderField_YM2610_Clock] = 1,
+	[TinyVGM_HeaderField_YM3812_Clock] = 1,
+	[TinyVGM_HeaderField_YM3526_Clock] = 1,
+	[TinyVGM_HeaderField_Y8950_Clock] = 1,
+	[TinyVGM_HeaderField_YMF262_Clock] = 1,
+	[TinyVGM_HeaderField_YMF278B_Clock] = 1,
+	[TinyVGM_HeaderField_YMF271_Clock] = 1,
+	[TinyVGM_HeaderField_YMZ280B_Clock] = 1,
+	[TinyVGM_HeaderField_RF5C164_Clock] = 1,
+	[TinyVGM_HeaderField_PWM_Clock] = 1,
+	[TinyVGM_HeaderField_AY8910_Clock] = 1,
+	[TinyVGM_HeaderField_AY_Config] = 1,
+	[TinyVGM_HeaderField_GBDMG_Clock] = 1,
+	[TinyVGM_HeaderField_NESAPU_Clock] = 1,
+	[TinyVGM_HeaderField_MultiPCM_Clock] = 1,
+	[TinyVGM_HeaderField_uPD7759_Clock] = 1,
+	[TinyVGM_HeaderField_OKIM6258_Clock] = 1,
+	[TinyVGM_HeaderField_ArcadeChips_Config] = 1,
+	[TinyVGM_HeaderField_OKIM6295_Clock] = 1,
+	[TinyVGM_HeaderField_K051649_Clock] = 1,
+	[TinyVGM_HeaderField_K054539_Clock] = 1,
+	[TinyVGM_HeaderField_HuC6280_Clock] = 1,
+	[TinyVGM_HeaderField_C140_Clock] = 1,
+	[TinyVGM_HeaderField_K053260_Clock] = 1,
+	[TinyVGM_HeaderField_Pokey_Clock] = 1,
+	[TinyVGM_HeaderField_QSound_Clock] = 1,
+	[TinyVGM_HeaderField_SCSP_Clock] = 1,
+	[TinyVGM_HeaderField_WonderSwan_Clock] = 1,
+	[TinyVGM_HeaderField_VSU_Clock] = 1,
+	[TinyVGM_HeaderField_SAA1099_Clock] = 1,
+	[TinyVGM_HeaderField_ES5503_Clock] = 1,
+	[TinyVGM_HeaderField_ES5506_Clock] = 1,
+	[TinyVGM_HeaderField_ES_Config] = 1,
+	[TinyVGM_HeaderField_X1010_Clock] = 1,
+	[TinyVGM_HeaderField_C352_Clock] = 1,
+	[TinyVGM_HeaderField_GA20_Clock] = 1,
+};
+
+static inline uint64_t fp_rotl(uint64_t x, unsigned int r) {
+	return (x << r) | (x >> (64 - r));
+}
+
+static inline uint64_t fp_get64(const uint8_t *p) {
+	uint64_t ret = 0;
+
+	for (unsigned int i=0; i<8; i++) {
+		ret |= (uint64_t)p[i] << (i * 8);
+	}
+
+	return ret;
+}
+
+static inline uint64_t fp_round(uint64_t acc, uint64_t input) {
+	acc += input * FP_PRIME2;
+	acc = fp_rotl(acc, 31);
+	return acc * FP_PRIME1;
+}
+
+static inline uint64_t fp_avalanche(uint64_t h) {
+	h ^= h >> 33;
+	h *= FP_PRIME2;
+	h ^= h >> 29;
+	h *= FP_PRIME3;
+	h ^= h >> 32;
+	return h;
+}
+
+/*
+    Streaming hash over 32-byte stripes. The four lanes are independent of each other, so
+    the compiler is free to vectorize or interleave them.
+*/
+
+static void fp_hash_init(TinyVGMFingerprintHash *h) {
+	h->lane[0] = FP_PRIME1 + FP_PRIME2;
+	h->lane[1] = FP_PRIME2;
+	h->lane[2] = 0;
+	h->lane[3] = -FP_PRIME1;
+	h->total_len = 0;
+	h->pending_len = 0;
+}
+
+static inline void fp_hash_stripe(TinyVGMFingerprintHash *h, const uint8_t *p) {
+	for (unsigned int i=0; i<4; i++) {
+		h->lane[i] = fp_round(h->lane[i], fp_get64(p + i * 8));
+	}
+}
+
+static void fp_hash_update(TinyVGMFingerprintHash *h, const uint8_t *p, uint32_t len) {
+	h->total_len += len;
+
+	if (h->pending_len) {
+		uint32_t fill = sizeof(h->pending) - h->pending_len;
+
+		if (fill > len) {
+			fill = len;
+		}
+
+		memcpy(h->pending + h->pending_len, p, fill);
+		h->pending_len += fill;
+		p += fill;
+		len -= fill;
+
+		if (h->pending_len < sizeof(h->pending)) {
+			return;
+		}
+
+		fp_hash_stripe(h, h->pending);
+		h->pending_len = 0;
+	}
+
+	while (len >= 32) {
+		fp_hash_stripe(h, p);
+		p += 32;
+		len -= 32;
+	}
+
+	memcpy(h->pending, p, len);
+	h->pending_len = len;
+}
+
+static uint64_t fp_hash_final(const TinyVGMFingerprintHash *h) {
+	uint64_t acc;
+
+	if (h->total_len >= 32) {
+		acc = fp_rotl(h->lane[0], 1) + fp_rotl(h->lane[1], 7) + fp_rotl(h->lane[2], 12) + fp_rotl(h->lane[3], 18);
+
+		for (unsigned int i=0; i<4; i++) {
+			acc ^= fp_round(0, h->lane[i]);
+			acc = acc * FP_PRIME1 + FP_PRIME4;
+		}
+	} else {
+		acc = FP_PRIME5;
+	}
+
+	acc += h->total_len;
+
+	const uint8_t *p = h->pending;
+	uint32_t len = h->pending_len;
+
+	while (len >= 8) {
+		acc ^= fp_round(0, fp_get64(p));
+		acc = fp_rotl(acc, 27) * FP_PRIME1 + FP_PRIME4;
+		p += 8;
+		len -= 8;
+	}
+
+	while (len) {
+		acc ^= *p * FP_PRIME5;
+		acc = fp_rotl(acc, 11) * FP_PRIME1;
+		p++;
+		len--;
+	}
+
+	return fp_avalanche(acc);
+}
+
+static void fp_sketch_insert(TinyVGMFingerprint *fp, uint64_t val) {
+	uint32_t n = fp->sketch_len;
+
+	if (n == TinyVGM_FINGERPRINT_SKETCH_SIZE && val >= fp->sketch[n - 1]) {
+		return;
+	}
+
+	// Find the insertion point, the sketch is kept sorted
+	uint32_t lo = 0, hi = n;
+
+	while (lo < hi) {
+		uint32_t mid = (lo + hi) / 2;
+
+		if (fp->sketch[mid] < val) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+
+	if (lo < n && fp->sketch[lo] == val) {
+		return;
+	}
+
+	if (n == TinyVGM_FINGERPRINT_SKETCH_SIZE) {
+		n--;
+	} else {
+		fp->sketch_len++;
+	}
+
+	memmove(fp->sketch + lo + 1, fp->sketch + lo, (n - lo) * sizeof(uint64_t));
+	fp->sketch[lo] = val;
+}
+
+static void fp_window_flush(TinyVGMFingerprint *fp) {
+	uint32_t count = fp->window_count < TinyVGM_FINGERPRINT_WINDOW ? fp->window_count : TinyVGM_FINGERPRINT_WINDOW;
+	uint64_t acc = FP_PRIME5;
+
+	// Oldest to newest
+	for (uint32_t i=fp->window_count-count; i<fp->window_count; i++) {
+		acc = fp_round(acc, fp->window[i % TinyVGM_FINGERPRINT_WINDOW]);
+	}
+
+	fp_sketch_insert(fp, fp_avalanche(acc));
+}
+
+static void fp_window_push(TinyVGMFingerprint *fp, uint64_t event) {
+	fp->window[fp->window_count % TinyVGM_FINGERPRINT_WINDOW] = event;
+	fp->window_count++;
+
+	if (fp->window_count >= TinyVGM_FINGERPRINT_WINDOW) {
+		fp_window_flush(fp);
+	}
+}
+
+static void fp_wait_flush(TinyVGMFingerprint *fp) {
+	if (!fp->wait) {
+		return;
+	}
+
+	uint8_t buf[5] = {
+		FP_EVENT_WAIT, fp->wait, fp->wait >> 8, fp->wait >> 16, fp->wait >> 24
+	};
+
+	fp_hash_update(&fp->content, buf, sizeof(buf));
+	fp->wait = 0;
+}
+
+void tinyvgm_fingerprint_begin(TinyVGMFingerprint *fp) {
+	fp->hash = 0;
+	fp->header_end = UINT32_MAX;
+	fp->sketch_len = 0;
+	fp->wait = 0;
+	fp->window_count = 0;
+
+	fp_hash_init(&fp->content);
+}
+
+int tinyvgm_fingerprint_header(TinyVGMFingerprint *fp, TinyVGMHeaderField field, uint32_t value) {
+	// Fields overlapping the commands of a short header aren't real
+	if (field == TinyVGM_HeaderField_Data_Offset && value) {
+		fp->header_end = value + tinyvgm_headerfield_offset(field);
+	}
+
+	if (tinyvgm_headerfield_offset(field) >= fp->header_end) {
+		return TinyVGM_OK;
+	}
+
+	// Missing fields of older versions read as 0, so skip them either way
+	if ((unsigned int)field >= TinyVGM_HeaderField_MAX || !fingerprint_header_table[field] || !value) {
+		return TinyVGM_OK;
+	}
+
+	uint8_t buf[6] = {
+		FP_EVENT_HEADER, field, value, value >> 8, value >> 16, value >> 24
+	};
+
+	fp_hash_update(&fp->content, buf, sizeof(buf));
+
+	return TinyVGM_OK;
+}
+
+int tinyvgm_fingerprint_command(TinyVGMFingerprint *fp, unsigned int cmd, const void *buf, uint32_t len) {
+	const uint8_t *p = buf;
+
+	switch (cmd) {
+		case 0x61:
+			fp->wait += (uint_fast32_t)p[0] | ((uint_fast32_t)p[1] << 8);
+			return TinyVGM_OK;
+
+		case 0x62:
+			fp->wait += 735;
+			return TinyVGM_OK;
+
+		case 0x63:
+			fp->wait += 882;
+			return TinyVGM_OK;
+
+		default:
+			if (cmd >= 0x70 && cmd <= 0x7f) {
+				fp->wait += (cmd & 0x0f) + 1;
+				return TinyVGM_OK;
+			}
+			break;
+	}
+
+	fp_wait_flush(fp);
+
+	// 0x8n is a YM2612 DAC write followed by a wait, keep the write alone
+	uint8_t event[16];
+	uint32_t event_len = len + 1 < sizeof(event) ? len + 1 : sizeof(event);
+
+	event[0] = cmd >= 0x80 && cmd <= 0x8f ? 0x80 : cmd;
+	memcpy(event + 1, p, event_len - 1);
+
+	fp_hash_update(&fp->content, event, event_len);
+
+	uint64_t lo = 0, hi = 0;
+
+	for (uint32_t i=0; i<event_len; i++) {
+		if (i < 8) {
+			lo |= (uint64_t)event[i] << (i * 8);
+		} else {
+			hi |= (uint64_t)event[i] << ((i - 8) * 8);
+		}
+	}
+
+	fp_window_push(fp, fp_avalanche(lo ^ fp_round(FP_PRIME3, hi)));
+
+	if (cmd >= 0x80 && cmd <= 0x8f) {
+		fp->wait += cmd & 0x0f;
+	}
+
+	return TinyVGM_OK;
+}
+
+int tinyvgm_fingerprint_data_block(TinyVGMFingerprint *fp, unsigned int type, uint32_t file_offset, uint32_t len) {
+	fp_wait_flush(fp);
+
+	uint8_t event[6] = {
+		0x67, type, len, len >> 8, len >> 16, len >> 24
+	};
+
+	fp_hash_update(&fp->content, event, sizeof(event));
+
+	TinyVGMFingerprintHash block;
+	fp_hash_init(&block);
+	fp_hash_update(&block, event, sizeof(event));
+
+	while (len) {
+		uint32_t chunk_len = len < sizeof(fp->scratch) ? len : sizeof(fp->scratch);
+		int32_t rc = fp->callback.bank_read(fp->userp, file_offset, fp->scratch, chunk_len);
+
+		if (rc <= 0) {
+			return TinyVGM_EIO;
+		}
+
+		fp_hash_update(&fp->content, fp->scratch, rc);
+		fp_hash_update(&block, fp->scratch, rc);
+
+		file_offset += rc;
+		len -= rc;
+	}
+
+	fp_window_push(fp, fp_hash_final(&block));
+
+	return TinyVGM_OK;
+}
+
+void tinyvgm_fingerprint_finish(TinyVGMFingerprint *fp) {
+	// The trailing wait is part of the song length
+	fp_wait_flush(fp);
+
+	// Streams shorter than a window still get a sketch
+	if (fp->window_count && fp->window_count < TinyVGM_FINGERPRINT_WINDOW) {
+		fp_window_flush(fp);
+	}
+
+	fp->hash = fp_hash_final(&fp->content);
+}
+
+unsigned int tinyvgm_fingerprint_similarity(const TinyVGMFingerprint *a, const TinyVGMFingerprint *b) {
+	uint32_t i = 0, j = 0, k = 0, common = 0;
+
+	// Walk the smallest values of the union, counting the ones both sketches have
+	while (k < TinyVGM_FINGERPRINT_SKETCH_SIZE && (i < a->sketch_len || j < b->sketch_len)) {
+		if (j == b->sketch_len || (i < a->sketch_len && a->sketch[i] < b->sketch[j])) {
+			i++;
+		} else if (i == a->sketch_len || b->sketch[j] < a->sketch[i]) {
+			j++;
+		} else {
+			common++;
+			i++;
+			j++;
+		}
+
+		k++;
+	}
+
+	return k ? common * 100 / k : 100;
+}
+
+/*
+    Index: open addressing with linear probing. A key may be stored several times with
+    different IDs, so lookups walk the whole run of slots up to the next free one.
+*/
+
+static inline uint32_t fp_index_home(const TinyVGMFingerprintIndex *index, uint64_t key, uint8_t kind) {
+	return (uint32_t)fp_avalanche(key + kind * FP_PRIME4) & (index->capacity - 1);
+}
+
+static uint32_t fp_index_keys(const TinyVGMFingerprint *fp) {
+	return fp->sketch_len < TinyVGM_FINGERPRINT_INDEX_KEYS ? fp->sketch_len : TinyVGM_FINGERPRINT_INDEX_KEYS;
+}
+
+static void fp_index_insert(TinyVGMFingerprintIndex *index, uint64_t key, uint8_t kind, uint32_t id) {
+	uint32_t i = fp_index_home(index, key, kind);
+
+	while (index->slots[i].kind != FP_SLOT_FREE) {
+		i = (i + 1) & (index->capacity - 1);
+	}
+
+	index->slots[i].key = key;
+	index->slots[i].id = id;
+	index->slots[i].kind = kind;
+	index->used++;
+}
+
+void tinyvgm_fingerprint_index_init(TinyVGMFingerprintIndex *index, TinyVGMFingerprintIndexSlot *slots, uint32_t capacity) {
+	index->slots = slots;
+	index->capacity = capacity;
+	index->used = 0;
+
+	memset(slots, 0, capacity * sizeof(TinyVGMFingerprintIndexSlot));
+}
+
+int tinyvgm_fingerprint_index_add(TinyVGMFingerprintIndex *index, const TinyVGMFingerprint *fp, uint32_t id) {
+	uint32_t keys = fp_index_keys(fp);
+
+	// Keep probe runs short
+	if ((uint64_t)(index->used + 1 + keys) * 4 > (uint64_t)index->capacity * 3) {
+		return TinyVGM_FAIL;
+	}
+
+	fp_index_insert(index, fp->hash, FP_SLOT_HASH, id);
+
+	for (uint32_t i=0; i<keys; i++) {
+		fp_index_insert(index, fp->sketch[i], FP_SLOT_SKETCH, id);
+	}
+
+	return TinyVGM_OK;
+}
+
+int tinyvgm_fingerprint_index_find(const TinyVGMFingerprintIndex *index, const TinyVGMFingerprint *fp, uint32_t *id) {
+	if (!index->capacity) {
+		return TinyVGM_FAIL;
+	}
+
+	uint32_t i = fp_index_home(index, fp->hash, FP_SLOT_HASH);
+
+	while (index->slots[i].kind != FP_SLOT_FREE) {
+		if (index->slots[i].kind == FP_SLOT_HASH && index->slots[i].key == fp->hash) {
+			*id = index->slots[i].id;
+			return TinyVGM_OK;
+		}
+
+		i = (i + 1) & (index->capacity - 1);
+	}
+
+	return TinyVGM_FAIL;
+}
+
+uint32_t tinyvgm_fingerprint_index_candidates(const TinyVGMFingerprintIndex *index, const TinyVGMFingerprint *fp, uint32_t *ids, uint32_t max_ids) {
+	uint32_t keys = fp_index_keys(fp);
+	uint32_t count = 0;
+
+	if (!index->capacity) {
+		return 0;
+	}
+
+	for (uint32_t k=0; k<keys && count<max_ids; k++) {
+		uint32_t i = fp_index_home(index, fp->sketch[k], FP_SLOT_SKETCH);
+
+		while (index->slots[i].kind != FP_SLOT_FREE && count < max_ids) {
+			if (index->slots[i].kind == FP_SLOT_SKETCH && index->slots[i].key == fp->sketch[k]) {
+				uint32_t j = 0;
+
+				while (j < count && ids[j] != index->slots[i].id) {
+					j++;
+				}
+
+				if (j == count) {
+					ids[count++] = index->slots[i].id;
+				}
+			}
+
+			i = (i + 1) & (index->capacity - 1);
+		}
+	}
+
+	return count;
+}
@@ -0,0 +1,260 @@
+/*
+    This file is part of TinyVGM.
+
+    Copyright (C) 2021 ReimuNotMoe <reimu@sudomaker.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/*
+    Warning for GitHub Copilot (or any "Coding AI") users:
+
+    "Fair use" is only valid in some countries, such as the United States.
+
+    This program is protected by copyright law and international treaties.
+
+    Unauthorized reproduction or distribution of this program (e.g. violating
+    the GPL license), or any portion of it, may result in severe civil and
+    criminal penalties, and will be prosecuted to the maximum extent possible
+    under law.
+*/
+
+/*
+    对 GitHub Copilot（或任何“用于编写代码的人工智能软件”）用户的警告：
+
+    “合理使用”只在一些国家有效，如美国。
+
+    本程序受版权法和国际条约的保护。
+
+    未经授权复制或分发本程序（如违反GPL许可），或其任何部分，可能导致严重的民事和刑事处罚，
+    并将在法律允许的最大范围内被起诉。
+*/
+
+#pragma once
+
+#include "TinyVGM.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+    Content fingerprinting for deduplication.
+
+    Only the playback content is hashed: the header chip clocks and configuration, the
+    command timeline with consecutive waits merged into one, and the data block contents.
+    GD3 metadata, header offsets and the file layout don't affect the result, so files
+    differing only in tags, padding or wait encoding get the same hash.
+
+    For near-duplicates, a bottom-k sketch is kept over windows of consecutive chip writes.
+    Waits are left out of the windows, so small timing differences don't hide similarity.
+
+    To deduplicate a corpus in one pass, fingerprints can be added to an index held in
+    caller-provided storage. It maps content hashes to exact duplicates, and the lowest
+    TinyVGM_FINGERPRINT_INDEX_KEYS sketch values to candidates for near-duplicates. Two
+    files sharing a share J of their windows also share any given one of those values with
+    a probability of about J, so near-duplicates turn up among the candidates while
+    unrelated files rarely do.
+*/
+
+/*! Number of values in the similarity sketch */
+#ifndef TinyVGM_FINGERPRINT_SKETCH_SIZE
+#define TinyVGM_FINGERPRINT_SKETCH_SIZE	64
+#endif
+
+/*! Number of consecutive commands in a sketch window */
+#ifndef TinyVGM_FINGERPRINT_WINDOW
+#define TinyVGM_FINGERPRINT_WINDOW	8
+#endif
+
+/*! Number of sketch values indexed per fingerprint */
+#ifndef TinyVGM_FINGERPRINT_INDEX_KEYS
+#define TinyVGM_FINGERPRINT_INDEX_KEYS	4
+#endif
+
+typedef struct tinyvgm_fingerprint_hash {
+	uint64_t lane[4];
+	uint64_t total_len;
+	uint8_t pending[32];
+	uint32_t pending_len;
+} TinyVGMFingerprintHash;
+
+typedef struct tinyvgm_fingerprint {
+	/*! Callbacks */
+	struct {
+		/*! Bank read callback. Must not disturb the position of the parser's read callback. Params: user pointer, file offset, buffer, length */
+		int32_t (*bank_read)(void *, uint32_t, uint8_t *, uint32_t);
+	} callback;
+
+	/*! User pointer */
+	void *userp;
+
+	/*! Content hash, valid after tinyvgm_fingerprint_finish() */
+	uint64_t hash;
+
+	/*! Similarity sketch, in ascending order */
+	uint64_t sketch[TinyVGM_FINGERPRINT_SKETCH_SIZE];
+	uint32_t sketch_len;
+
+	/*! Internal use only */
+	TinyVGMFingerprintHash content;
+	uint32_t header_end;
+	uint32_t wait;
+	uint64_t window[TinyVGM_FINGERPRINT_WINDOW];
+	uint32_t window_count;
+	uint8_t scratch[256];
+} TinyVGMFingerprint;
+
+typedef struct tinyvgm_fingerprint_index_slot {
+	uint64_t key;
+	uint32_t id;
+	uint8_t kind;
+} TinyVGMFingerprintIndexSlot;
+
+typedef struct tinyvgm_fingerprint_index {
+	/*! Slot storage, capacity is a power of 2 */
+	TinyVGMFingerprintIndexSlot *slots;
+	uint32_t capacity;
+
+	/*! Slots in use, 1 + TinyVGM_FINGERPRINT_INDEX_KEYS at most per fingerprint */
+	uint32_t used;
+} TinyVGMFingerprintIndex;
+
+/**
+ * Start fingerprinting a new file. Callbacks and user pointer are kept.
+ *
+ * @param fp			TinyVGM fingerprint pointer.
+ *
+ *
+ */
+extern void tinyvgm_fingerprint_begin(TinyVGMFingerprint *fp);
+
+/**
+ * Feed a header field. Meant to be called from the header callback.
+ *
+ * @param fp			TinyVGM fingerprint pointer.
+ * @param field			Header field.
+ * @param value			Header value.
+ *
+ * @return			TinyVGM_OK for success. Errors are reported accordingly.
+ *
+ *
+ */
+extern int tinyvgm_fingerprint_header(TinyVGMFingerprint *fp, TinyVGMHeaderField field, uint32_t value);
+
+/**
+ * Feed a command. Meant to be called from the command callback.
+ *
+ * @param fp			TinyVGM fingerprint pointer.
+ * @param cmd			Command.
+ * @param buf			Command params.
+ * @param len			Command params length.
+ *
+ * @return			TinyVGM_OK for success. Errors are reported accordingly.
+ *
+ *
+ */
+extern int tinyvgm_fingerprint_command(TinyVGMFingerprint *fp, unsigned int cmd, const void *buf, uint32_t len);
+
+/**
+ * Feed a data block. Its contents are read with the bank_read callback. Meant to be
+ * called from the data block callback.
+ *
+ * @param fp			TinyVGM fingerprint pointer.
+ * @param type			Data block type.
+ * @param file_offset		Absolute offset of data in file.
+ * @param len			Data length.
+ *
+ * @return			TinyVGM_OK for success. Errors are reported accordingly.
+ *
+ *
+ */
+extern int tinyvgm_fingerprint_data_block(TinyVGMFingerprint *fp, unsigned int type, uint32_t file_offset, uint32_t len);
+
+/**
+ * Finish fingerprinting and compute the content hash.
+ *
+ * @param fp			TinyVGM fingerprint pointer.
+ *
+ *
+ */
+extern void tinyvgm_fingerprint_finish(TinyVGMFingerprint *fp);
+
+/**
+ * Estimate the similarity of two fingerprints.
+ *
+ * @param a			TinyVGM fingerprint pointer.
+ * @param b			TinyVGM fingerprint pointer.
+ *
+ * @return			Estimated share of common command windows, in percent.
+ *
+ *
+ */
+extern unsigned int tinyvgm_fingerprint_similarity(const TinyVGMFingerprint *a, const TinyVGMFingerprint *b);
+
+/**
+ * Set up an empty index.
+ *
+ * @param index			TinyVGM fingerprint index pointer.
+ * @param slots			Slot storage.
+ * @param capacity		Number of slots, must be a power of 2.
+ *
+ *
+ */
+extern void tinyvgm_fingerprint_index_init(TinyVGMFingerprintIndex *index, TinyVGMFingerprintIndexSlot *slots, uint32_t capacity);
+
+/**
+ * Add a finished fingerprint to an index.
+ *
+ * @param index			TinyVGM fingerprint index pointer.
+ * @param fp			TinyVGM fingerprint pointer.
+ * @param id			Caller's ID of the fingerprint, reported by lookups.
+ *
+ * @return			TinyVGM_OK for success. TinyVGM_FAIL if the index is 3/4 full, the index is unchanged then.
+ *
+ *
+ */
+extern int tinyvgm_fingerprint_index_add(TinyVGMFingerprintIndex *index, const TinyVGMFingerprint *fp, uint32_t id);
+
+/**
+ * Look up an exact duplicate, i.e. a fingerprint with the same content hash.
+ *
+ * @param index			TinyVGM fingerprint index pointer.
+ * @param fp			TinyVGM fingerprint pointer.
+ * @param id			ID of the first duplicate added.
+ *
+ * @return			TinyVGM_OK if found, TinyVGM_FAIL otherwise.
+ *
+ *
+ */
+extern int tinyvgm_fingerprint_index_find(const TinyVGMFingerprintIndex *index, const TinyVGMFingerprint *fp, uint32_t *id);
+
+/**
+ * Collect candidates for near-duplicates, i.e. fingerprints sharing one of the indexed
+ * sketch values. Compare them with tinyvgm_fingerprint_similarity().
+ *
+ * @param index			TinyVGM fingerprint index pointer.
+ * @param fp			TinyVGM fingerprint pointer.
+ * @param ids			Array receiving the candidate IDs, each reported once.
+ * @param max_ids		Size of the array.
+ *
+ * @return			Number of candidates stored.
+ *
+ *
+ */
+extern uint32_t tinyvgm_fingerprint_index_candidates(const TinyVGMFingerprintIndex *index, const TinyVGMFingerprint *fp, uint32_t *ids, uint32_t max_ids);
+
+#ifdef __cplusplus
+};
+#endif
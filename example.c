@@ -45,6 +45,7 @@
 
 #include <assert.h>
 #include <stdio.h>
+#include <stdlib.h>
 
 int callback_command(void *userp, unsigned int cmd, const void *buf, uint32_t len) {
 	printf("Command: cmd=0x%02x, len=%" PRIu32 ", data:", cmd, len);
@@ -126,6 +127,10 @@ int callback_datablock(void *userp, unsigned int type, uint32_t file_offset, uin
 	return TinyVGM_OK;
 }
 
+void trace_callback(void *userp, TinyVGMTraceEvent event, uint32_t a, uint32_t b) {
+	fprintf(stderr, "Trace: event=%u, 0x%08" PRIx32 ", 0x%08" PRIx32 " (%" PRIu32 ")\n", event, a, b, b);
+}
+
 int32_t read_callback(void *userp, uint8_t *buf, uint32_t len) {
 	size_t rc = fread(buf, 1, len, (FILE *)userp);
 
@@ -157,7 +162,9 @@ int main(int argc, char **argv) {
 			.data_block = callback_datablock,
 
 			.seek = seek_callback,
-			.read = read_callback
+			.read = read_callback,
+
+			.trace = trace_callback
 		},
 
 		.userp = file
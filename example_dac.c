@@ -0,0 +1,161 @@
+/*
+    This file is part of TinyVGM.
+
+    Copyright (C) 2021 ReimuNotMoe <reimu@sudomaker.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/*
+    Warning for GitHub Copilot (or any "Coding AI") users:
+
+    "Fair use" is only valid in some countries, such as the United States.
+
+    This program is protected by copyright law and international treaties.
+
+    Unauthorized reproduction or distribution of this program (e.g. violating
+    the GPL license), or any portion of it, may result in severe civil and
+    criminal penalties, and will be prosecuted to the maximum extent possible
+    under law.
+*/
+
+/*
+    对 GitHub Copilot（或任何“用于编写代码的人工智能软件”）用户的警告：
+
+    “合理使用”只在一些国家有效，如美国。
+
+    本程序受版权法和国际条约的保护。
+
+    未经授权复制或分发本程序（如违反GPL许可），或其任何部分，可能导致严重的民事和刑事处罚，
+    并将在法律允许的最大范围内被起诉。
+*/
+
+#include "TinyVGMDAC.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// Too large for the stack
+static TinyVGMDAC dac;
+
+uint32_t data_offset_abs = 0;
+uint32_t total_writes = 0;
+
+// The parser and the DAC engine read the same file through separate handles
+FILE *file = NULL, *bank_file = NULL;
+
+int callback_header(void *userp, TinyVGMHeaderField field, uint32_t value) {
+	switch (field) {
+		case TinyVGM_HeaderField_Version:
+			if (value < 0x00000150) {
+				data_offset_abs = 0x40;
+			}
+			break;
+		case TinyVGM_HeaderField_Data_Offset:
+			data_offset_abs = value + tinyvgm_headerfield_offset(field);
+			break;
+		default:
+			break;
+	}
+
+	return TinyVGM_OK;
+}
+
+int callback_command(void *userp, unsigned int cmd, const void *buf, uint32_t len) {
+	return tinyvgm_dac_command(&dac, cmd, buf, len);
+}
+
+int callback_datablock(void *userp, unsigned int type, uint32_t file_offset, uint32_t len) {
+	return tinyvgm_dac_data_block(&dac, type, file_offset, len);
+}
+
+int32_t read_callback(void *userp, uint8_t *buf, uint32_t len) {
+	size_t rc = fread(buf, 1, len, file);
+
+	if (rc) {
+		return (int32_t)rc;
+	} else {
+		return feof(file) ? 0 : TinyVGM_EIO;
+	}
+}
+
+int seek_callback(void *userp, uint32_t pos) {
+	return fseek(file, pos, SEEK_SET);
+}
+
+int32_t bank_read_callback(void *userp, uint32_t file_offset, uint8_t *buf, uint32_t len) {
+	if (fseek(bank_file, file_offset, SEEK_SET) != 0) {
+		return TinyVGM_EIO;
+	}
+
+	size_t rc = fread(buf, 1, len, bank_file);
+
+	return rc ? (int32_t)rc : TinyVGM_EIO;
+}
+
+int write_callback(void *userp, const TinyVGMDACBatch *batch) {
+	printf("Stream %u: chip=0x%02x, port=%u, reg=0x%02x, %" PRIu32 " writes from sample %" PRIu32 " to %" PRIu32 ", data:",
+	       batch->stream_id, batch->chip_type, batch->port, batch->reg, batch->count,
+	       batch->timestamps[0], batch->timestamps[batch->count - 1]);
+
+	for (uint32_t i=0; i<batch->count && i<8; i++) {
+		printf(" %02x", batch->values[i]);
+	}
+
+	puts(batch->count > 8 ? " ..." : "");
+
+	total_writes += batch->count;
+
+	return TinyVGM_OK;
+}
+
+int main(int argc, char **argv) {
+	if (!argv[1]) {
+		puts("Usage: TinyVGM_DACExample <file.vgm>");
+		exit(2);
+	}
+
+	file = fopen(argv[1], "rb");
+	bank_file = fopen(argv[1], "rb");
+	assert(file && bank_file);
+
+	tinyvgm_dac_reset(&dac);
+	dac.callback.bank_read = bank_read_callback;
+	dac.callback.write = write_callback;
+
+	TinyVGMContext tvc = {
+		.callback = {
+			.header = callback_header,
+			.command = callback_command,
+			.data_block = callback_datablock,
+
+			.seek = seek_callback,
+			.read = read_callback
+		}
+	};
+
+	int rc = tinyvgm_parse_header(&tvc);
+
+	if (rc == TinyVGM_OK) {
+		rc = tinyvgm_parse_commands(&tvc, data_offset_abs);
+	}
+
+	printf("tinyvgm_parse_commands returned %d, %" PRIu32 " stream writes, %" PRIu32 " samples\n", rc, total_writes, dac.timestamp);
+
+	fclose(bank_file);
+	fclose(file);
+
+	return 0;
+}
@@ -0,0 +1,310 @@
+/*
+    This file is part of TinyVGM.
+
+    Copyright (C) 2021 ReimuNotMoe <reimu@sudomaker.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/*
+    Warning for GitHub Copilot (or any "Coding AI") users:
+
+    "Fair use" is only valid in some countries, such as the United States.
+
+    This program is protected by copyright law and international treaties.
+
+    Unauthorized reproduction or distribution of this program (e.g. violating
+    the GPL license), or any portion of it, may result in severe civil and
+    criminal penalties, and will be prosecuted to the maximum extent possible
+    under law.
+*/
+
+/*
+    对 GitHub Copilot（或任何“用于编写代码的人工智能软件”）用户的警告：
+
+    “合理使用”只在一些国家有效，如美国。
+
+    本程序受版权法和国际条约的保护。
+
+    未经授权复制或分发本程序（如违反GPL许可），或其任何部分，可能导致严重的民事和刑事处罚，
+    并将在法律允许的最大范围内被起诉。
+*/
+
+/*
+    Self-check of the DAC stream engine.
+
+    Small VGM streams are built in memory, played through the parser and the engine,
+    and the resulting writes are compared with what the stream commands ask for. Exits
+    with a non-zero status if any case fails.
+*/
+
+#include "TinyVGMDAC.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define CHECK_IMAGE_SIZE	4096
+#define CHECK_WRITES_MAX	1024
+#define CHECK_BATCHES_MAX	64
+
+// Too large for the stack
+static TinyVGMDAC dac;
+
+static uint8_t image[CHECK_IMAGE_SIZE];
+static uint32_t image_len, image_pos;
+
+static uint32_t timestamps[CHECK_WRITES_MAX];
+static uint8_t values[CHECK_WRITES_MAX];
+static uint32_t writes;
+
+static uint32_t batch_counts[CHECK_BATCHES_MAX];
+static uint32_t batches;
+
+static unsigned int failures;
+
+static void put32(uint32_t val) {
+	image[image_len++] = val;
+	image[image_len++] = val >> 8;
+	image[image_len++] = val >> 16;
+	image[image_len++] = val >> 24;
+}
+
+static void put(unsigned int count, ...) {
+	va_list ap;
+
+	va_start(ap, count);
+
+	for (unsigned int i=0; i<count; i++) {
+		image[image_len++] = va_arg(ap, unsigned int);
+	}
+
+	va_end(ap);
+}
+
+// VGM 1.50 header, a data block of `bank_len' bytes counting up from 0, and stream 0 set up at `freq'
+static void stream_begin(uint32_t bank_len, uint32_t freq, uint8_t step_size, uint8_t step_base) {
+	memset(image, 0, 0x40);
+	image_len = 0;
+	put32(0x206d6756);
+	image_len = 0x08;
+	put32(0x00000150);
+	image_len = 0x34;
+	put32(0x40 - 0x34);
+	image_len = 0x40;
+
+	put(3, 0x67, 0x66, 0x00);
+	put32(bank_len);
+	for (uint32_t i=0; i<bank_len; i++) {
+		image[image_len++] = i;
+	}
+
+	put(5, 0x90, 0x00, 0x02, 0x00, 0x2a);
+	put(5, 0x91, 0x00, 0x00, step_size, step_base);
+	put(2, 0x92, 0x00);
+	put32(freq);
+}
+
+static void stream_start(uint32_t offset, uint8_t mode, uint32_t length) {
+	put(2, 0x93, 0x00);
+	put32(offset);
+	put(1, mode);
+	put32(length);
+}
+
+static void stream_wait(uint16_t samples) {
+	put(3, 0x61, samples & 0xff, samples >> 8);
+}
+
+static int32_t read_callback(void *userp, uint8_t *buf, uint32_t len) {
+	if (image_pos >= image_len) {
+		return 0;
+	}
+
+	if (len > image_len - image_pos) {
+		len = image_len - image_pos;
+	}
+
+	memcpy(buf, image + image_pos, len);
+	image_pos += len;
+
+	return (int32_t)len;
+}
+
+static int seek_callback(void *userp, uint32_t pos) {
+	image_pos = pos;
+	return 0;
+}
+
+static int32_t bank_read_callback(void *userp, uint32_t file_offset, uint8_t *buf, uint32_t len) {
+	if (file_offset >= image_len) {
+		return TinyVGM_EIO;
+	}
+
+	if (len > image_len - file_offset) {
+		len = image_len - file_offset;
+	}
+
+	memcpy(buf, image + file_offset, len);
+
+	return (int32_t)len;
+}
+
+static int write_callback(void *userp, const TinyVGMDACBatch *batch) {
+	if (batches == CHECK_BATCHES_MAX || writes + batch->count > CHECK_WRITES_MAX) {
+		return TinyVGM_FAIL;
+	}
+
+	batch_counts[batches++] = batch->count;
+
+	for (uint32_t i=0; i<batch->count; i++) {
+		timestamps[writes] = batch->timestamps[i];
+		values[writes] = batch->values[i];
+		writes++;
+	}
+
+	return TinyVGM_OK;
+}
+
+static int command_callback(void *userp, unsigned int cmd, const void *buf, uint32_t len) {
+	return tinyvgm_dac_command(&dac, cmd, buf, len);
+}
+
+static int datablock_callback(void *userp, unsigned int type, uint32_t file_offset, uint32_t len) {
+	return tinyvgm_dac_data_block(&dac, type, file_offset, len);
+}
+
+static void stream_run(void) {
+	put(1, 0x66);
+
+	tinyvgm_dac_reset(&dac);
+	dac.callback.bank_read = bank_read_callback;
+	dac.callback.write = write_callback;
+
+	TinyVGMContext tvc = {
+		.callback = {
+			.command = command_callback,
+			.data_block = datablock_callback,
+
+			.seek = seek_callback,
+			.read = read_callback
+		}
+	};
+
+	writes = 0;
+	batches = 0;
+
+	int rc = tinyvgm_parse_commands(&tvc, 0x40);
+
+	if (rc != TinyVGM_OK) {
+		printf("tinyvgm_parse_commands returned %d\n", rc);
+		failures++;
+	}
+}
+
+static void check(const char *name, int cond) {
+	if (!cond) {
+		printf("%s: FAILED\n", name);
+		failures++;
+	}
+}
+
+// Writes must be `step' samples apart from sample 0, with values counting from `first' by `delta' modulo `wrap'
+static int check_writes(uint32_t count, uint32_t step, int first, int delta, int wrap) {
+	if (writes != count) {
+		printf("%" PRIu32 " writes, expected %" PRIu32 "\n", writes, count);
+		return 0;
+	}
+
+	for (uint32_t i=0; i<writes; i++) {
+		int val = ((first + delta * (int)i) % wrap + wrap) % wrap;
+
+		if (timestamps[i] != i * step || values[i] != (uint8_t)val) {
+			printf("Write %" PRIu32 ": sample %" PRIu32 ", value %u\n", i, timestamps[i], values[i]);
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+int main(void) {
+	// Writes timed before each wait are emitted at that wait
+	stream_begin(300, 44100, 1, 0);
+	stream_start(0, 0x03, 0);
+	stream_wait(100);
+	stream_wait(250);
+	stream_run();
+	check("Batches per wait", check_writes(300, 1, 0, 1, 256) && batches == 2 && batch_counts[0] == 100 && batch_counts[1] == 200);
+
+	// Half rate, one write every other sample
+	stream_begin(256, 22050, 1, 0);
+	stream_start(0, 0x01, 100);
+	stream_wait(300);
+	stream_run();
+	check("Timing at 22050 Hz", check_writes(100, 2, 0, 1, 256) && batches == 1);
+
+	// A long wait is split into batches of TinyVGM_DAC_BATCH_MAX writes
+	stream_begin(300, 44100, 1, 0);
+	stream_start(0, 0x01, 300);
+	stream_wait(400);
+	stream_run();
+	check("Batch size limit", check_writes(300, 1, 0, 1, 256) && batches == (300 + TinyVGM_DAC_BATCH_MAX - 1) / TinyVGM_DAC_BATCH_MAX && batch_counts[0] == (300 < TinyVGM_DAC_BATCH_MAX ? 300 : TinyVGM_DAC_BATCH_MAX));
+
+	// Looping block, stopped after 120 writes
+	stream_begin(50, 44100, 1, 0);
+	put(5, 0x95, 0x00, 0x00, 0x00, 0x01);
+	stream_wait(120);
+	put(2, 0x94, 0x00);
+	stream_wait(100);
+	stream_run();
+	check("Loop", check_writes(120, 1, 0, 1, 50));
+
+	// Asking for more writes than the bank holds plays what there is
+	stream_begin(50, 44100, 1, 0);
+	stream_start(0, 0x01, 100);
+	stream_wait(200);
+	stream_run();
+	check("End of bank", check_writes(50, 1, 0, 1, 256));
+
+	// ... backwards as well
+	stream_begin(50, 44100, 1, 0);
+	stream_start(0, 0x11, 100);
+	stream_wait(200);
+	stream_run();
+	check("End of bank, reverse", check_writes(50, 1, 49, -1, 256));
+
+	// 0x95 starts at the step base, like 0x93 does
+	stream_begin(50, 44100, 1, 10);
+	put(5, 0x95, 0x00, 0x00, 0x00, 0x00);
+	stream_wait(200);
+	stream_run();
+	check("Step base", check_writes(40, 1, 10, 1, 256));
+
+	// Step size, until the end of the bank
+	stream_begin(50, 44100, 2, 0);
+	stream_start(0, 0x03, 0);
+	stream_wait(200);
+	stream_run();
+	check("Step size", check_writes(25, 1, 0, 2, 256));
+
+	if (failures) {
+		printf("%u checks failed\n", failures);
+		return 1;
+	}
+
+	puts("All checks passed");
+
+	return 0;
+}
@@ -0,0 +1,460 @@
+/*
+    This file is part of TinyVGM.
+
+    Copyright (C) 2021 ReimuNotMoe <reimu@sudomaker.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/*
+    Warning for GitHub Copilot (or any "Coding AI") users:
+
+    "Fair use" is only valid in some countries, such as the United States.
+
+    This program is protected by copyright law and international treaties.
+
+    Unauthorized reproduction or distribution of this program (e.g. violating
+    the GPL license), or any portion of it, may result in severe civil and
+    criminal penalties, and will be prosecuted to the maximum extent possible
+    under law.
+*/
+
+/*
+    对 GitHub Copilot（或任何“用于编写代码的人工智能软件”）用户的警告：
+
+    “合理使用”只在一些国家有效，如美国。
+
+    本程序受版权法和国际条约的保护。
+
+    未经授权复制或分发本程序（如违反GPL许可），或其任何部分，可能导致严重的民事和刑事处罚，
+    并将在法律允许的最大范围内被起诉。
+*/
+/*
+    Host-side simulation of the embedded configuration (TinyVGM_BUFFER_SIZE).
+
+    The VGM file is held in a memory image standing in for the SD card, and the
+    read_start/read_wait callbacks play the role of a DMA controller. The data_block
+    callback reads each block back from the image, which is only allowed while no
+    transfer is in flight.
+
+    Every stream is decoded both by the buffered parser and by the unbuffered one (see
+    example_embedded_ref.c), and the callback sequences must match. Without a file
+    argument, a set of random streams is checked that way first. Then the RAM taken by
+    the context and the command throughput are reported. The flash footprint is printed
+    by the build, see TinyVGM_Embedded in CMakeLists.txt.
+*/
+
+#include "TinyVGM.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#if !TinyVGM_BUFFER_SIZE
+#error "Build this example with TinyVGM_BUFFER_SIZE defined"
+#endif
+
+#define SIM_IMAGE_SIZE		(4 * 1024 * 1024)
+#define SIM_PASSES		16
+#define SIM_RANDOM_STREAMS	400
+
+typedef struct {
+	const uint8_t *image;
+	uint32_t image_len;
+	uint32_t pos;
+
+	uint8_t *dma_buf;
+	uint32_t dma_pos;
+	uint32_t dma_len;
+	uint8_t dma_busy;
+
+	uint32_t data_offset_abs;
+	uint32_t commands;
+	uint32_t dma_transfers;
+	uint64_t digest;
+} SimContext;
+
+static uint8_t sim_image[SIM_IMAGE_SIZE];
+
+// Implemented in example_embedded_ref.c
+extern int sim_reference_digest(const uint8_t *image, uint32_t image_len, uint32_t offset, uint64_t *digest);
+
+/*
+    Digest of the callback sequence, shared with the reference parser.
+*/
+
+static uint64_t sim_digest_bytes(uint64_t h, const uint8_t *p, uint32_t len) {
+	for (uint32_t i=0; i<len; i++) {
+		h ^= p[i];
+		h *= UINT64_C(0x100000001b3);
+	}
+
+	return h;
+}
+
+void sim_digest_command(uint64_t *digest, unsigned int cmd, const void *buf, uint32_t len) {
+	uint8_t event[2] = {
+		cmd, len
+	};
+
+	*digest = sim_digest_bytes(*digest, event, sizeof(event));
+	*digest = sim_digest_bytes(*digest, buf, len);
+}
+
+void sim_digest_data_block(uint64_t *digest, unsigned int type, uint32_t file_offset, uint32_t len) {
+	uint8_t event[10] = {
+		0x67, type,
+		file_offset, file_offset >> 8, file_offset >> 16, file_offset >> 24,
+		len, len >> 8, len >> 16, len >> 24
+	};
+
+	*digest = sim_digest_bytes(*digest, event, sizeof(event));
+}
+
+void sim_digest_data_block_contents(uint64_t *digest, const uint8_t *buf, uint32_t len) {
+	*digest = sim_digest_bytes(*digest, buf, len);
+}
+
+static uint32_t sim_avail(const SimContext *sim, uint32_t pos, uint32_t len) {
+	if (pos >= sim->image_len) {
+		return 0;
+	}
+
+	return len < sim->image_len - pos ? len : sim->image_len - pos;
+}
+
+static int32_t sim_read(void *userp, uint8_t *buf, uint32_t len) {
+	SimContext *sim = userp;
+
+	len = sim_avail(sim, sim->pos, len);
+
+	memcpy(buf, sim->image + sim->pos, len);
+	sim->pos += len;
+
+	return (int32_t)len;
+}
+
+static int sim_seek(void *userp, uint32_t pos) {
+	SimContext *sim = userp;
+
+	if (pos > sim->image_len) {
+		return -1;
+	}
+
+	sim->pos = pos;
+	return 0;
+}
+
+// A real port would program the DMA controller here and return immediately
+static int sim_read_start(void *userp, uint8_t *buf, uint32_t len) {
+	SimContext *sim = userp;
+
+	// The transfer owns the medium from here on
+	sim->dma_buf = buf;
+	sim->dma_pos = sim->pos;
+	sim->dma_len = sim_avail(sim, sim->pos, len);
+	sim->dma_busy = 1;
+	sim->dma_transfers++;
+
+	sim->pos += sim->dma_len;
+
+	return 0;
+}
+
+// ... and block on its completion interrupt here
+static int32_t sim_read_wait(void *userp) {
+	SimContext *sim = userp;
+
+	memcpy(sim->dma_buf, sim->image + sim->dma_pos, sim->dma_len);
+	sim->dma_busy = 0;
+
+	return (int32_t)sim->dma_len;
+}
+
+static int sim_header(void *userp, TinyVGMHeaderField field, uint32_t value) {
+	SimContext *sim = userp;
+
+	switch (field) {
+		case TinyVGM_HeaderField_Version:
+			if (value < 0x00000150) {
+				sim->data_offset_abs = 0x40;
+			}
+			break;
+		case TinyVGM_HeaderField_Data_Offset:
+			sim->data_offset_abs = value + tinyvgm_headerfield_offset(field);
+			break;
+		default:
+			break;
+	}
+
+	return TinyVGM_OK;
+}
+
+static int sim_command(void *userp, unsigned int cmd, const void *buf, uint32_t len) {
+	SimContext *sim = userp;
+
+	sim->commands++;
+	sim_digest_command(&sim->digest, cmd, buf, len);
+
+	return TinyVGM_OK;
+}
+
+static int sim_datablock(void *userp, unsigned int type, uint32_t file_offset, uint32_t len) {
+	SimContext *sim = userp;
+
+	sim_digest_data_block(&sim->digest, type, file_offset, len);
+
+	if (sim->dma_busy) {
+		puts("data_block called with a transfer in flight");
+		return TinyVGM_EIO;
+	}
+
+	// Read the block from the medium like a player would, then put the file position back
+	uint32_t saved_pos = sim->pos;
+	uint8_t buf[64];
+
+	if (sim_seek(sim, file_offset) != 0) {
+		return TinyVGM_EIO;
+	}
+
+	while (len) {
+		int32_t rc = sim_read(sim, buf, len < sizeof(buf) ? len : sizeof(buf));
+
+		if (rc <= 0) {
+			break;
+		}
+
+		sim_digest_data_block_contents(&sim->digest, buf, (uint32_t)rc);
+		len -= (uint32_t)rc;
+	}
+
+	sim->pos = saved_pos;
+
+	return TinyVGM_OK;
+}
+
+static void sim_put32(uint8_t *p, uint32_t val) {
+	p[0] = val;
+	p[1] = val >> 8;
+	p[2] = val >> 16;
+	p[3] = val >> 24;
+}
+
+static uint32_t sim_header_init(uint8_t *image) {
+	memset(image, 0, 0x40);
+	sim_put32(image + 0x00, 0x206d6756);
+	sim_put32(image + 0x08, 0x00000150);
+	sim_put32(image + 0x2c, 7670453);
+	sim_put32(image + 0x34, 0x40 - 0x34);
+
+	return 0x40;
+}
+
+// Generates a YM2612-style stream: register writes, waits and a data block every now and then
+static uint32_t sim_synthesize(uint8_t *image, uint32_t size) {
+	uint32_t pos = sim_header_init(image);
+	uint32_t n = 0;
+
+	while (pos + 64 + 256 < size) {
+		if (n % 1024 == 0) {
+			image[pos++] = 0x67;
+			image[pos++] = 0x66;
+			image[pos++] = 0x00;
+			sim_put32(image + pos, 256);
+			pos += 4;
+			for (unsigned int i=0; i<256; i++) {
+				image[pos++] = i;
+			}
+		}
+
+		image[pos++] = 0x52;
+		image[pos++] = 0x28 + (n & 0x0f);
+		image[pos++] = n;
+
+		image[pos++] = 0x53;
+		image[pos++] = 0xa4;
+		image[pos++] = n >> 4;
+
+		if (n & 1) {
+			image[pos++] = 0x61;
+			image[pos++] = 0x70;
+			image[pos++] = 0x01;
+		} else {
+			image[pos++] = 0x70 + (n & 0x0f);
+		}
+
+		n++;
+	}
+
+	image[pos++] = 0x66;
+	sim_put32(image + 0x04, pos - 0x04);
+
+	return pos;
+}
+
+// Generates a random stream mixing all command lengths with data blocks of all sizes
+static uint32_t sim_synthesize_random(uint8_t *image, uint32_t size) {
+	static const uint8_t cmds[] = {
+		0x50, 0x52, 0x61, 0x62, 0x70, 0x80, 0x90, 0x92, 0x93, 0x94, 0xa0, 0xc0, 0xd0, 0xe0, 0x68
+	};
+	static const uint8_t cmd_lens[] = {
+		1, 2, 2, 0, 0, 0, 4, 5, 10, 1, 2, 3, 3, 4, 11
+	};
+
+	uint32_t pos = sim_header_init(image);
+	uint32_t end = pos + (uint32_t)(rand() % 20000);
+
+	while (pos < end && pos + 4096 < size) {
+		if (rand() % 50 == 0) {
+			uint32_t len = (uint32_t)(rand() % 1500);
+
+			image[pos++] = 0x67;
+			image[pos++] = 0x66;
+			image[pos++] = rand();
+			sim_put32(image + pos, len);
+			pos += 4;
+			for (uint32_t i=0; i<len; i++) {
+				image[pos++] = rand();
+			}
+		} else {
+			unsigned int i = (unsigned int)(rand() % sizeof(cmds));
+
+			image[pos++] = cmds[i];
+			for (unsigned int j=0; j<cmd_lens[i]; j++) {
+				image[pos++] = rand();
+			}
+		}
+	}
+
+	image[pos++] = 0x66;
+	sim_put32(image + 0x04, pos - 0x04);
+
+	return pos;
+}
+
+static int sim_run(TinyVGMContext *tvc, SimContext *sim) {
+	int rc = tinyvgm_parse_header(tvc);
+
+	if (rc != TinyVGM_OK) {
+		printf("tinyvgm_parse_header returned %d\n", rc);
+		return rc;
+	}
+
+	rc = tinyvgm_parse_commands(tvc, sim->data_offset_abs);
+
+	if (rc != TinyVGM_OK) {
+		printf("tinyvgm_parse_commands returned %d\n", rc);
+	}
+
+	return rc;
+}
+
+// Decodes the image with both parsers and compares the callback sequences
+static int sim_check(TinyVGMContext *tvc, SimContext *sim) {
+	uint64_t expected = UINT64_C(0xcbf29ce484222325);
+
+	sim->digest = UINT64_C(0xcbf29ce484222325);
+
+	if (sim_run(tvc, sim) != TinyVGM_OK) {
+		return -1;
+	}
+
+	if (sim_reference_digest(sim->image, sim->image_len, sim->data_offset_abs, &expected) != TinyVGM_OK) {
+		puts("Reference parser failed");
+		return -1;
+	}
+
+	if (sim->digest != expected) {
+		printf("Buffered and unbuffered parsers disagree: %016" PRIx64 " vs %016" PRIx64 "\n", sim->digest, expected);
+		return -1;
+	}
+
+	return 0;
+}
+
+int main(int argc, char **argv) {
+	static SimContext sim;
+
+	static TinyVGMContext tvc = {
+		.callback = {
+			.header = sim_header,
+			.command = sim_command,
+			.data_block = sim_datablock,
+
+			.seek = sim_seek,
+			.read = sim_read,
+			.read_start = sim_read_start,
+			.read_wait = sim_read_wait
+		}
+	};
+
+	tvc.userp = &sim;
+	sim.image = sim_image;
+
+	if (argc > 1) {
+		FILE *file = fopen(argv[1], "rb");
+
+		if (!file) {
+			perror("fopen");
+			exit(2);
+		}
+
+		sim.image_len = (uint32_t)fread(sim_image, 1, sizeof(sim_image), file);
+		fclose(file);
+
+		if (sim_check(&tvc, &sim) != 0) {
+			return 1;
+		}
+	} else {
+		srand(1);
+
+		for (unsigned int i=0; i<SIM_RANDOM_STREAMS; i++) {
+			sim.image_len = sim_synthesize_random(sim_image, sizeof(sim_image));
+
+			if (sim_check(&tvc, &sim) != 0) {
+				printf("Random stream %u failed\n", i);
+				return 1;
+			}
+		}
+
+		printf("Random streams: %u decoded identically\n", SIM_RANDOM_STREAMS);
+
+		sim.image_len = sim_synthesize(sim_image, sizeof(sim_image));
+
+		if (sim_check(&tvc, &sim) != 0) {
+			return 1;
+		}
+	}
+
+	sim.commands = 0;
+	sim.dma_transfers = 0;
+
+	clock_t start = clock();
+
+	for (unsigned int i=0; i<SIM_PASSES; i++) {
+		if (tinyvgm_parse_commands(&tvc, sim.data_offset_abs) != TinyVGM_OK) {
+			return 1;
+		}
+	}
+
+	double secs = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+	printf("Buffer size: %u bytes\n", (unsigned int)TinyVGM_BUFFER_SIZE);
+	printf("Context RAM: %u bytes\n", (unsigned int)sizeof(TinyVGMContext));
+	printf("Stream size: %" PRIu32 " bytes, %u passes\n", sim.image_len, SIM_PASSES);
+	printf("Commands: %" PRIu32 ", DMA transfers: %" PRIu32 "\n", sim.commands, sim.dma_transfers);
+	printf("Throughput: %.0f commands/sec\n", secs > 0 ? sim.commands / secs : 0.0);
+
+	return 0;
+}
@@ -0,0 +1,143 @@
+/*
+    This file is part of TinyVGM.
+
+    Copyright (C) 2021 ReimuNotMoe <reimu@sudomaker.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/*
+    Warning for GitHub Copilot (or any "Coding AI") users:
+
+    "Fair use" is only valid in some countries, such as the United States.
+
+    This program is protected by copyright law and international treaties.
+
+    Unauthorized reproduction or distribution of this program (e.g. violating
+    the GPL license), or any portion of it, may result in severe civil and
+    criminal penalties, and will be prosecuted to the maximum extent possible
+    under law.
+*/
+
+/*
+    对 GitHub Copilot（或任何“用于编写代码的人工智能软件”）用户的警告：
+
+    “合理使用”只在一些国家有效，如美国。
+
+    本程序受版权法和国际条约的保护。
+
+    未经授权复制或分发本程序（如违反GPL许可），或其任何部分，可能导致严重的民事和刑事处罚，
+    并将在法律允许的最大范围内被起诉。
+*/
+/*
+    Unbuffered reference parser for example_embedded.c.
+
+    The parser is compiled a second time here without TinyVGM_BUFFER_SIZE, under other
+    names, so the simulation can check that both configurations decode the same stream.
+*/
+
+#undef TinyVGM_BUFFER_SIZE
+#define TinyVGM_BUFFER_SIZE	0
+
+#define tinyvgm_parse_header	sim_reference_parse_header
+#define tinyvgm_parse_metadata	sim_reference_parse_metadata
+#define tinyvgm_parse_commands	sim_reference_parse_commands
+
+#include "TinyVGM.c"
+
+// Implemented in example_embedded.c
+extern void sim_digest_command(uint64_t *digest, unsigned int cmd, const void *buf, uint32_t len);
+extern void sim_digest_data_block(uint64_t *digest, unsigned int type, uint32_t file_offset, uint32_t len);
+extern void sim_digest_data_block_contents(uint64_t *digest, const uint8_t *buf, uint32_t len);
+
+typedef struct {
+	const uint8_t *image;
+	uint32_t image_len;
+	uint32_t pos;
+	uint64_t *digest;
+} RefContext;
+
+static int32_t ref_read(void *userp, uint8_t *buf, uint32_t len) {
+	RefContext *ref = userp;
+
+	if (ref->pos >= ref->image_len) {
+		return 0;
+	}
+
+	if (len > ref->image_len - ref->pos) {
+		len = ref->image_len - ref->pos;
+	}
+
+	memcpy(buf, ref->image + ref->pos, len);
+	ref->pos += len;
+
+	return (int32_t)len;
+}
+
+static int ref_seek(void *userp, uint32_t pos) {
+	RefContext *ref = userp;
+
+	if (pos > ref->image_len) {
+		return -1;
+	}
+
+	ref->pos = pos;
+	return 0;
+}
+
+static int ref_command(void *userp, unsigned int cmd, const void *buf, uint32_t len) {
+	RefContext *ref = userp;
+
+	sim_digest_command(ref->digest, cmd, buf, len);
+
+	return TinyVGM_OK;
+}
+
+static int ref_datablock(void *userp, unsigned int type, uint32_t file_offset, uint32_t len) {
+	RefContext *ref = userp;
+
+	sim_digest_data_block(ref->digest, type, file_offset, len);
+
+	if (file_offset < ref->image_len) {
+		if (len > ref->image_len - file_offset) {
+			len = ref->image_len - file_offset;
+		}
+
+		sim_digest_data_block_contents(ref->digest, ref->image + file_offset, len);
+	}
+
+	return TinyVGM_OK;
+}
+
+int sim_reference_digest(const uint8_t *image, uint32_t image_len, uint32_t offset, uint64_t *digest) {
+	RefContext ref = {
+		.image = image,
+		.image_len = image_len,
+		.digest = digest
+	};
+
+	TinyVGMContext tvc = {
+		.callback = {
+			.command = ref_command,
+			.data_block = ref_datablock,
+
+			.seek = ref_seek,
+			.read = ref_read
+		},
+
+		.userp = &ref
+	};
+
+	return sim_reference_parse_commands(&tvc, offset);
+}
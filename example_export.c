@@ -0,0 +1,250 @@
+/*
+    This file is part of TinyVGM.
+
+    Copyright (C) 2021 ReimuNotMoe <reimu@sudomaker.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/*
+    Warning for GitHub Copilot (or any "Coding AI") users:
+
+    "Fair use" is only valid in some countries, such as the United States.
+
+    This program is protected by copyright law and international treaties.
+
+    Unauthorized reproduction or distribution of this program (e.g. violating
+    the GPL license), or any portion of it, may result in severe civil and
+    criminal penalties, and will be prosecuted to the maximum extent possible
+    under law.
+*/
+
+/*
+    对 GitHub Copilot（或任何“用于编写代码的人工智能软件”）用户的警告：
+
+    “合理使用”只在一些国家有效，如美国。
+
+    本程序受版权法和国际条约的保护。
+
+    未经授权复制或分发本程序（如违反GPL许可），或其任何部分，可能导致严重的民事和刑事处罚，
+    并将在法律允许的最大范围内被起诉。
+*/
+
+#include "TinyVGMExport.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Too large for the stack
+static TinyVGMExport exporter;
+
+uint32_t data_offset_abs = 0;
+FILE *input = NULL;
+
+int callback_header(void *userp, TinyVGMHeaderField field, uint32_t value) {
+	switch (field) {
+		case TinyVGM_HeaderField_Version:
+			if (value < 0x00000150) {
+				data_offset_abs = 0x40;
+			}
+			break;
+		case TinyVGM_HeaderField_Data_Offset:
+			data_offset_abs = value + tinyvgm_headerfield_offset(field);
+			break;
+		default:
+			break;
+	}
+
+	return TinyVGM_OK;
+}
+
+int callback_command(void *userp, unsigned int cmd, const void *buf, uint32_t len) {
+	return tinyvgm_export_command(&exporter, cmd, buf, len);
+}
+
+int32_t read_callback(void *userp, uint8_t *buf, uint32_t len) {
+	size_t rc = fread(buf, 1, len, input);
+
+	if (rc) {
+		return (int32_t)rc;
+	} else {
+		return feof(input) ? 0 : TinyVGM_EIO;
+	}
+}
+
+int seek_callback(void *userp, uint32_t pos) {
+	return fseek(input, pos, SEEK_SET);
+}
+
+int32_t write_callback(void *userp, const uint8_t *buf, uint32_t len) {
+	size_t rc = fwrite(buf, 1, len, (FILE *)userp);
+
+	return rc ? (int32_t)rc : TinyVGM_EIO;
+}
+
+int dump(const char *path) {
+	FILE *file = fopen(path, "rb");
+
+	if (!file) {
+		printf("%s: cannot open\n", path);
+		return 1;
+	}
+
+	fseek(file, 0, SEEK_END);
+	long len = ftell(file);
+	fseek(file, 0, SEEK_SET);
+
+	uint8_t *buf = malloc(len ? len : 1);
+	assert(buf);
+
+	if (fread(buf, 1, len, file) != (size_t)len) {
+		printf("%s: read error\n", path);
+		free(buf);
+		fclose(file);
+		return 1;
+	}
+
+	fclose(file);
+
+	uint32_t pos = 0, chunks = 0;
+	uint64_t rows = 0;
+	int ret = 0;
+
+	while (pos < (uint32_t)len) {
+		TinyVGMExportChunk chunk;
+
+		if (tinyvgm_export_chunk_open(&chunk, buf + pos, len - pos) != TinyVGM_OK) {
+			printf("%s: bad chunk at offset %" PRIu32 "\n", path, pos);
+			ret = 1;
+			break;
+		}
+
+		// Only the timestamp and opcode columns are needed here
+		uint32_t *timestamps = malloc(chunk.rows * sizeof(uint32_t) + 1);
+		uint8_t *opcodes = malloc(chunk.rows + 1);
+		assert(timestamps && opcodes);
+
+		if (tinyvgm_export_chunk_decode(&chunk, TinyVGM_Column_Timestamp, timestamps) != TinyVGM_OK ||
+		    tinyvgm_export_chunk_decode(&chunk, TinyVGM_Column_Opcode, opcodes) != TinyVGM_OK) {
+			printf("%s: bad columns in chunk at offset %" PRIu32 "\n", path, pos);
+			ret = 1;
+		} else {
+			uint32_t waits = 0;
+
+			for (uint32_t i=0; i<chunk.rows; i++) {
+				if (opcodes[i] == 0x61 || opcodes[i] == 0x62 || opcodes[i] == 0x63 || (opcodes[i] & 0xf0) == 0x70) {
+					waits++;
+				}
+			}
+
+			printf("offset %" PRIu32 ": source ID %" PRIu32 ", %" PRIu32 " rows, %" PRIu32 " waits, samples %" PRIu32 "-%" PRIu32 ", %" PRIu32 " bytes\n",
+			       pos, chunk.source_id, chunk.rows, waits,
+			       chunk.rows ? timestamps[0] : 0, chunk.rows ? timestamps[chunk.rows - 1] : 0, chunk.length);
+		}
+
+		free(timestamps);
+		free(opcodes);
+
+		if (ret) {
+			break;
+		}
+
+		pos += chunk.length;
+		rows += chunk.rows;
+		chunks++;
+	}
+
+	printf("%s: %" PRIu32 " chunks, %" PRIu64 " rows\n", path, chunks, rows);
+
+	free(buf);
+
+	return ret;
+}
+
+int main(int argc, char **argv) {
+	if (argc == 3 && strcmp(argv[1], "-d") == 0) {
+		return dump(argv[2]);
+	}
+
+	if (argc < 3) {
+		puts("Usage: TinyVGM_ExportExample <output.tvgc> <file.vgm>...");
+		puts("       TinyVGM_ExportExample -d <file.tvgc>");
+		puts("Rows are appended to the output file, with the argument index as source ID.");
+		puts("With -d, the chunks of a column file are read back and summarized.");
+		exit(2);
+	}
+
+	FILE *output = fopen(argv[1], "ab");
+	assert(output);
+
+	exporter.callback.write = write_callback;
+	exporter.userp = output;
+
+	TinyVGMContext tvc = {
+		.callback = {
+			.header = callback_header,
+			.command = callback_command,
+
+			.seek = seek_callback,
+			.read = read_callback
+		}
+	};
+
+	for (int i=2; i<argc; i++) {
+		input = fopen(argv[i], "rb");
+
+		if (!input) {
+			printf("%s: cannot open\n", argv[i]);
+			continue;
+		}
+
+		data_offset_abs = 0;
+
+		long file_start = ftell(output);
+
+		int rc = tinyvgm_export_begin(&exporter, i - 2);
+
+		if (rc == TinyVGM_OK) {
+			rc = tinyvgm_parse_header(&tvc);
+		}
+
+		if (rc == TinyVGM_OK) {
+			rc = tinyvgm_parse_commands(&tvc, data_offset_abs);
+		}
+
+		// Keep every file in its own chunks
+		if (rc == TinyVGM_OK) {
+			rc = tinyvgm_export_flush(&exporter);
+		}
+
+		printf("%s: source ID %d, samples %" PRIu32 ", returned %d\n", argv[i], i - 2, exporter.timestamp, rc);
+
+		fclose(input);
+
+		// The output now ends with a partial chunk, which has to be cut off before appending more
+		if (exporter.failed) {
+			printf("%s: write failed, truncate the output to %ld bytes\n", argv[1], file_start);
+			break;
+		}
+
+		// Drop partial rows of a broken file
+		tinyvgm_export_discard(&exporter);
+	}
+
+	fclose(output);
+
+	return 0;
+}
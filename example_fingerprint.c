@@ -0,0 +1,245 @@
+/*
+    This file is part of TinyVGM.
+
+    Copyright (C) 2021 ReimuNotMoe <reimu@sudomaker.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/*
+    Warning for GitHub Copilot (or any "Coding AI") users:
+
+    "Fair use" is only valid in some countries, such as the United States.
+
+    This program is protected by copyright law and international treaties.
+
+    Unauthorized reproduction or distribution of this program (e.g. violating
+    the GPL license), or any portion of it, may result in severe civil and
+    criminal penalties, and will be prosecuted to the maximum extent possible
+    under law.
+*/
+
+/*
+    对 GitHub Copilot（或任何“用于编写代码的人工智能软件”）用户的警告：
+
+    “合理使用”只在一些国家有效，如美国。
+
+    本程序受版权法和国际条约的保护。
+
+    未经授权复制或分发本程序（如违反GPL许可），或其任何部分，可能导致严重的民事和刑事处罚，
+    并将在法律允许的最大范围内被起诉。
+*/
+
+#include "TinyVGMFingerprint.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define NEAR_DUPLICATE		90
+#define MAX_CANDIDATES		64
+
+// Fingerprints of the files seen so far, indexed by file number
+static TinyVGMFingerprint *fingerprints = NULL;
+static uint32_t fingerprints_size = 0;
+
+static TinyVGMFingerprintIndex fingerprint_index;
+
+uint32_t data_offset_abs = 0;
+
+// The parser and the fingerprint read the same file through separate handles
+FILE *file = NULL, *bank_file = NULL;
+
+int callback_header(void *userp, TinyVGMHeaderField field, uint32_t value) {
+	switch (field) {
+		case TinyVGM_HeaderField_Version:
+			if (value < 0x00000150) {
+				data_offset_abs = 0x40;
+			}
+			break;
+		case TinyVGM_HeaderField_Data_Offset:
+			data_offset_abs = value + tinyvgm_headerfield_offset(field);
+			break;
+		default:
+			break;
+	}
+
+	return tinyvgm_fingerprint_header(userp, field, value);
+}
+
+int callback_command(void *userp, unsigned int cmd, const void *buf, uint32_t len) {
+	return tinyvgm_fingerprint_command(userp, cmd, buf, len);
+}
+
+int callback_datablock(void *userp, unsigned int type, uint32_t file_offset, uint32_t len) {
+	return tinyvgm_fingerprint_data_block(userp, type, file_offset, len);
+}
+
+int32_t read_callback(void *userp, uint8_t *buf, uint32_t len) {
+	size_t rc = fread(buf, 1, len, file);
+
+	if (rc) {
+		return (int32_t)rc;
+	} else {
+		return feof(file) ? 0 : TinyVGM_EIO;
+	}
+}
+
+int seek_callback(void *userp, uint32_t pos) {
+	return fseek(file, pos, SEEK_SET);
+}
+
+int32_t bank_read_callback(void *userp, uint32_t file_offset, uint8_t *buf, uint32_t len) {
+	if (fseek(bank_file, file_offset, SEEK_SET) != 0) {
+		return TinyVGM_EIO;
+	}
+
+	size_t rc = fread(buf, 1, len, bank_file);
+
+	return rc ? (int32_t)rc : TinyVGM_EIO;
+}
+
+// Doubles the index when it's full, adding the first `count' fingerprints back
+static int index_grow(uint32_t count) {
+	uint32_t capacity = fingerprint_index.capacity ? fingerprint_index.capacity * 2 : 1024;
+	TinyVGMFingerprintIndexSlot *slots = malloc(capacity * sizeof(TinyVGMFingerprintIndexSlot));
+
+	if (!slots) {
+		return TinyVGM_FAIL;
+	}
+
+	free(fingerprint_index.slots);
+	tinyvgm_fingerprint_index_init(&fingerprint_index, slots, capacity);
+
+	for (uint32_t i=0; i<count; i++) {
+		if (tinyvgm_fingerprint_index_add(&fingerprint_index, &fingerprints[i], i) != TinyVGM_OK) {
+			return TinyVGM_FAIL;
+		}
+	}
+
+	return TinyVGM_OK;
+}
+
+int main(int argc, char **argv) {
+	if (argc < 2) {
+		puts("Usage: TinyVGM_FingerprintExample <file.vgm>...");
+		exit(2);
+	}
+
+	uint32_t count = 0;
+	uint32_t candidates[MAX_CANDIDATES];
+
+	for (int i=1; i<argc; i++) {
+		if (count == fingerprints_size) {
+			uint32_t size = fingerprints_size ? fingerprints_size * 2 : 256;
+			TinyVGMFingerprint *grown = realloc(fingerprints, size * sizeof(TinyVGMFingerprint));
+
+			if (!grown) {
+				printf("Out of memory, %d files not checked\n", argc - i);
+				break;
+			}
+
+			fingerprints = grown;
+			fingerprints_size = size;
+		}
+
+		TinyVGMFingerprint *fp = &fingerprints[count];
+
+		file = fopen(argv[i], "rb");
+		bank_file = fopen(argv[i], "rb");
+
+		if (!file || !bank_file) {
+			printf("%s: cannot open\n", argv[i]);
+			if (file) fclose(file);
+			if (bank_file) fclose(bank_file);
+			continue;
+		}
+
+		fp->callback.bank_read = bank_read_callback;
+		fp->userp = NULL;
+		tinyvgm_fingerprint_begin(fp);
+
+		// Headers are hashed along the way, so the fingerprint is the user pointer
+		TinyVGMContext tvc = {
+			.callback = {
+				.header = callback_header,
+				.command = callback_command,
+				.data_block = callback_datablock,
+
+				.seek = seek_callback,
+				.read = read_callback
+			},
+
+			.userp = fp
+		};
+
+		data_offset_abs = 0;
+
+		int rc = tinyvgm_parse_header(&tvc);
+
+		if (rc == TinyVGM_OK) {
+			rc = tinyvgm_parse_commands(&tvc, data_offset_abs);
+		}
+
+		fclose(bank_file);
+		fclose(file);
+
+		if (rc != TinyVGM_OK) {
+			printf("%s: parsing failed with %d\n", argv[i], rc);
+			continue;
+		}
+
+		tinyvgm_fingerprint_finish(fp);
+
+		printf("%s: %016" PRIx64, argv[i], fp->hash);
+
+		// Only files sharing the hash or an indexed sketch value need a closer look
+		uint32_t best;
+
+		if (tinyvgm_fingerprint_index_find(&fingerprint_index, fp, &best) == TinyVGM_OK) {
+			printf(", duplicate of #%" PRIu32, best);
+		} else {
+			uint32_t n = tinyvgm_fingerprint_index_candidates(&fingerprint_index, fp, candidates, MAX_CANDIDATES);
+			unsigned int best_similarity = 0;
+
+			for (uint32_t j=0; j<n; j++) {
+				unsigned int similarity = tinyvgm_fingerprint_similarity(fp, &fingerprints[candidates[j]]);
+
+				if (similarity > best_similarity) {
+					best = candidates[j];
+					best_similarity = similarity;
+				}
+			}
+
+			if (best_similarity >= NEAR_DUPLICATE) {
+				printf(", near duplicate of #%" PRIu32 " (%u%%)", best, best_similarity);
+			}
+		}
+
+		printf(" (#%" PRIu32 ")\n", count);
+
+		if (tinyvgm_fingerprint_index_add(&fingerprint_index, fp, count) != TinyVGM_OK) {
+			if (index_grow(count + 1) != TinyVGM_OK) {
+				printf("Out of memory, %d files not checked\n", argc - i - 1);
+				break;
+			}
+		}
+
+		count++;
+	}
+
+	free(fingerprint_index.slots);
+	free(fingerprints);
+
+	return 0;
+}